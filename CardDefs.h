@@ -7,10 +7,19 @@
  */
 
 #include <iostream>
+#include <cstdint>
+#include <array>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 /// Typedef for single card
 typedef unsigned char Card;
 
+/// Typedef for a set of cards, where each card is represented with a single bit (see getCardIdx())
+typedef uint32_t CardMask;
+
 ///@name Suit related
 //@{
 
@@ -88,6 +97,34 @@ inline char getSuitSymb(CardSuit suit)
     return SUIT_SYMB_UNKNOWN;;
 }
 
+/// Value in symbol lookup tables, that indicates unrecognized symbol
+const unsigned char INVALID_SYMB = 0xff;
+
+/// Typedef for symbol lookup tables
+typedef std::array<unsigned char, 256> SymbTable;
+
+/**
+ * @brief Build suit symbols lookup table
+ *
+ * @return table that maps symbol to CardSuit value, or INVALID_SYMB for unrecognized symbols
+ */
+constexpr SymbTable makeSuitSymbTable()
+{
+    SymbTable table{};
+    for(unsigned int i = 0; i < table.size(); i++)
+        table[i] = INVALID_SYMB;
+
+    table[static_cast<unsigned char>(SUIT_SYMB_SPIDES)] = CS_SPIDES;
+    table[static_cast<unsigned char>(SUIT_SYMB_CLUBS)] = CS_CLUBS;
+    table[static_cast<unsigned char>(SUIT_SYMB_DIAMONDS)] = CS_DIAMONDS;
+    table[static_cast<unsigned char>(SUIT_SYMB_HEARTS)] = CS_HEARTS;
+    table[static_cast<unsigned char>(SUIT_SYMB_UNKNOWN)] = CS_UNKNOWN;
+    return table;
+}
+
+/// Suit symbols lookup table (see makeSuitSymbTable())
+inline constexpr SymbTable SUIT_SYMB_TABLE = makeSuitSymbTable();
+
 /**
  * @brief Parse suit symbol
  *
@@ -101,21 +138,9 @@ inline char getSuitSymb(CardSuit suit)
  */
 inline CardSuit parseSuitSymb(char c)
 {
-    switch(c)
-    {
-    case SUIT_SYMB_SPIDES:
-        return CS_SPIDES;
-    case SUIT_SYMB_CLUBS:
-        return CS_CLUBS;
-    case SUIT_SYMB_DIAMONDS:
-        return CS_DIAMONDS;
-    case SUIT_SYMB_HEARTS:
-        return CS_HEARTS;
-    case SUIT_SYMB_UNKNOWN:
-        return CS_UNKNOWN;
-    default:
-        break;
-    }
+    unsigned char suit = SUIT_SYMB_TABLE[static_cast<unsigned char>(c)];
+    if(suit != INVALID_SYMB)
+        return static_cast<CardSuit>(suit);
 
     throw "parseSuitSymb(): Unrecognized suit symbol";
 }
@@ -173,7 +198,26 @@ inline CardValue getCardValue(Card card)
 }
 
 /// Symbols for card values
-const char cardValueChars[] = {'2', '3', '4', '5', '6', '7', '8', '9', '1', 'J', 'Q', 'K', 'A', '?'};
+constexpr char cardValueChars[] = {'2', '3', '4', '5', '6', '7', '8', '9', '1', 'J', 'Q', 'K', 'A', '?'};
+
+/**
+ * @brief Build card value symbols lookup table
+ *
+ * @return table that maps symbol to CardValue, or INVALID_SYMB for unrecognized symbols
+ */
+constexpr SymbTable makeCardValueSymbTable()
+{
+    SymbTable table{};
+    for(unsigned int i = 0; i < table.size(); i++)
+        table[i] = INVALID_SYMB;
+
+    for(unsigned int i = 0; i < sizeof(cardValueChars); i++)
+        table[static_cast<unsigned char>(cardValueChars[i])] = static_cast<unsigned char>(i);
+    return table;
+}
+
+/// Card value symbols lookup table (see makeCardValueSymbTable())
+inline constexpr SymbTable CARD_VALUE_SYMB_TABLE = makeCardValueSymbTable();
 
 /**
  * @brief Retrieve the card value symbol
@@ -207,20 +251,189 @@ inline char getCardValueSymb(CardValue v)
  */
 inline CardValue parseCardValueSymb(char c)
 {
-    for(unsigned int i=0; i<sizeof(cardValueChars); i++)
-        if(cardValueChars[i] == c)
-            return static_cast<CardValue>(i);
+    unsigned char value = CARD_VALUE_SYMB_TABLE[static_cast<unsigned char>(c)];
+    if(value != INVALID_SYMB)
+        return static_cast<CardValue>(value);
 
     throw "parseCardValueSymb(): unknown card value";
 }
 
 
 /// Macro for making the whole card value from card suit and card value
-#define MAKE_CARD(suit, value) static_cast<Card>((suit&0xf0) | (value & 0x0f))
+#define MAKE_CARD(suit, value) static_cast<Card>(((suit)&0xf0) | ((value)&0x0f))
 
 /// A special value representing an unknown card
 const Card UNKNOWN_CARD = MAKE_CARD(CS_UNKNOWN, CV_UNKNOWN);
 
+///@name Card masks related
+//@{
+
+/// Number of cards of each suit in the Preferans deck (7 to Ace)
+const unsigned int CARDS_IN_SUIT = 8;
+
+/// Number of suits in the Preferans deck
+const unsigned int SUITS_COUNT = 4;
+
+/**
+ * @brief Check whether the card belongs to the Preferans deck
+ *
+ * Preferans is played with 32 cards: 4 suits of cards from 7 to Ace. Only such cards
+ * can be represented in a card mask.
+ *
+ * @param card - card to check
+ *
+ * @return \a true if card can be represented in a card mask, \a false otherwise
+ */
+inline bool isPreferansCard(Card card)
+{
+    return getSuit(card) <= CS_HEARTS &&
+           getCardValue(card) >= CV_7 &&
+           getCardValue(card) <= CV_ACE;
+}
+
+/**
+ * @brief Retrieve the card index
+ *
+ * Each card of the Preferans deck has its own index in the card mask. Cards are ordered
+ * the same way as the Card values: by suit first, and then by value. So that the
+ * lowest bit is 7 of spides, and the highest is ace of hearts.
+ *
+ * @note Card is not checked, see isPreferansCard()
+ *
+ * @param card - card to get index of
+ *
+ * @return zero based card index
+ */
+inline unsigned int getCardIdx(Card card)
+{
+    return ((card >> 4) * CARDS_IN_SUIT) + getCardValue(card) - CV_7;
+}
+
+/**
+ * @brief Make the card by its index
+ *
+ * @param idx - zero based card index (see getCardIdx())
+ *
+ * @return the card
+ */
+inline Card getCardByIdx(unsigned int idx)
+{
+    return MAKE_CARD((idx / CARDS_IN_SUIT) << 4, (idx % CARDS_IN_SUIT) + CV_7);
+}
+
+/**
+ * @brief Retrieve the card bit
+ *
+ * @note Card is not checked, see isPreferansCard()
+ *
+ * @param card - card to get bit of
+ *
+ * @return card mask with a single bit set
+ */
+inline CardMask getCardBit(Card card)
+{
+    return CardMask(1) << getCardIdx(card);
+}
+
+/**
+ * @brief Retrieve the mask of all cards of the suit
+ *
+ * @param suit - requested suit (except for CS_UNKNOWN)
+ *
+ * @return card mask with all cards of the suit set
+ */
+inline CardMask getSuitCardsMask(CardSuit suit)
+{
+    return CardMask(0xff) << ((suit >> 4) * CARDS_IN_SUIT);
+}
+
+/// Typedef for a set of cards of a single suit (one bit per card value, 7 to Ace)
+typedef uint8_t SuitMask;
+
+/**
+ * @brief Retrieve cards of the suit as a suit mask
+ *
+ * @param cards - card mask
+ * @param suit  - requested suit (except for CS_UNKNOWN)
+ *
+ * @return suit mask of cards of the requested suit
+ */
+inline SuitMask getSuitMask(CardMask cards, CardSuit suit)
+{
+    return static_cast<SuitMask>(cards >> ((suit >> 4) * CARDS_IN_SUIT));
+}
+
+/**
+ * @brief Convert suit mask back to card mask
+ *
+ * @param cards - suit mask
+ * @param suit  - suit of the cards (except for CS_UNKNOWN)
+ *
+ * @return card mask with the cards of the suit mask
+ */
+inline CardMask makeCardMask(SuitMask cards, CardSuit suit)
+{
+    return CardMask(cards) << ((suit >> 4) * CARDS_IN_SUIT);
+}
+
+/**
+ * @brief Count cards in the mask
+ *
+ * @param cards - card mask
+ *
+ * @return number of cards in the mask
+ */
+inline unsigned int countCards(CardMask cards)
+{
+#if defined(_MSC_VER)
+    return __popcnt(cards);
+#else
+    return __builtin_popcount(cards);
+#endif
+}
+
+/**
+ * @brief Retrieve the index of the lowest card in the mask
+ *
+ * @note Mask shall not be empty
+ *
+ * @param cards - card mask
+ *
+ * @return index of the lowest card
+ */
+inline unsigned int getLowestCardIdx(CardMask cards)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, cards);
+    return idx;
+#else
+    return __builtin_ctz(cards);
+#endif
+}
+
+/**
+ * @brief Retrieve the index of the highest card in the mask
+ *
+ * @note Mask shall not be empty
+ *
+ * @param cards - card mask
+ *
+ * @return index of the highest card
+ */
+inline unsigned int getHighestCardIdx(CardMask cards)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, cards);
+    return idx;
+#else
+    return 31 - __builtin_clz(cards);
+#endif
+}
+
+//@}
+
 /**
  * @brief Card serialization operator
  *
@@ -361,5 +574,113 @@ inline unsigned int calcTrickWinner(Card card1, Card card2, Card card3, CardSuit
     return iWinner;
 }
 
+///@name Trick calculation lookup tables
+//@{
+
+/// Number of suit indexes in lookup tables (4 suits and unknown suit)
+const unsigned int SUIT_IDX_COUNT = 5;
+
+/**
+ * @brief Retrieve suit index for lookup tables
+ *
+ * @param suit - the suit (CS_UNKNOWN is allowed)
+ *
+ * @return zero based suit index, CS_UNKNOWN gets the last index
+ */
+constexpr unsigned int getSuitIdx(CardSuit suit)
+{
+    return (static_cast<unsigned int>(suit) >> 4) < SUIT_IDX_COUNT - 1 ?
+           (static_cast<unsigned int>(suit) >> 4) : SUIT_IDX_COUNT - 1;
+}
+
+/// Card ranks table: [trump suit idx][first card suit idx][card]
+typedef std::array<std::array<std::array<unsigned char, 256>, SUIT_IDX_COUNT>, SUIT_IDX_COUNT> TrickRanksTable;
+
+/**
+ * @brief Build the trick card ranks table
+ *
+ * The card rank is a number that allows comparing cards in a trick directly, when the suit
+ * of the first card and the trump suit are known:
+ * - trumps get the highest ranks
+ * - cards of the first card suit go next
+ * - all the other cards get zero rank, as they never win the trick
+ * .
+ *
+ * @return the ranks table
+ */
+constexpr TrickRanksTable makeTrickRanksTable()
+{
+    TrickRanksTable table{};
+
+    for(unsigned int trump = 0; trump < SUIT_IDX_COUNT; trump++)
+        for(unsigned int first = 0; first < SUIT_IDX_COUNT; first++)
+            for(unsigned int card = 0; card < 256; card++)
+            {
+                unsigned int suit = getSuitIdx(static_cast<CardSuit>(card & CARD_SUIT_MASK));
+                unsigned int value = card & CARD_VALUE_MASK;
+
+                // Unknown suit idx means there is no trump at all
+                if(trump != SUIT_IDX_COUNT - 1 && suit == trump)
+                    table[trump][first][card] = static_cast<unsigned char>(0x20 | value);
+                else if(suit == first)
+                    table[trump][first][card] = static_cast<unsigned char>(0x10 | value);
+            }
+
+    return table;
+}
+
+/// Card ranks lookup table (see makeTrickRanksTable())
+inline constexpr TrickRanksTable TRICK_CARD_RANKS = makeTrickRanksTable();
+
+/**
+ * @brief Compare two cards (table driven)
+ *
+ * This function is equivalent to isCardHeigher(), but uses card ranks lookup table
+ * instead of comparisons.
+ *
+ * @note this function does not support unknown cards, only exact ones
+ *
+ * @param card  - card to be checked
+ * @param ref   - reference card
+ * @param trump - the trump suit, or CS_UNKNOWN if no trump suit defined
+ *
+ * @return \a true if card is heigher than reference card.
+ */
+inline bool lookupCardHeigher(Card card, Card ref, CardSuit trump = CS_UNKNOWN)
+{
+    const auto & ranks = TRICK_CARD_RANKS[getSuitIdx(trump)][getSuitIdx(getSuit(ref))];
+    return ranks[card] > ranks[ref];
+}
+
+/**
+ * @brief Calculate the trick winner (table driven)
+ *
+ * This function is equivalent to calcTrickWinner(), but uses card ranks lookup table
+ * so that the winner is calculated with 3 loads and branchless selection of the maximum.
+ *
+ * @note this function does not support unknown cards, only exact ones
+ *
+ * @param card1 - card played by 1st player
+ * @param card2 - card played by 2nd player
+ * @param card3 - card played by 3rd player
+ * @param trump - the trump suit, or CS_UNKNOWN if no trump suit defined
+ *
+ * @return zero based number of player that wins this trick
+ */
+inline unsigned int lookupTrickWinner(Card card1, Card card2, Card card3, CardSuit trump = CS_UNKNOWN)
+{
+    const auto & ranks = TRICK_CARD_RANKS[getSuitIdx(trump)][getSuitIdx(getSuit(card1))];
+    unsigned int rank1 = ranks[card1];
+    unsigned int rank2 = ranks[card2];
+    unsigned int rank3 = ranks[card3];
+
+    // Equal ranks are impossible for different cards, except for zero (card never wins)
+    unsigned int iWinner = rank2 > rank1 ? 1 : 0;
+    unsigned int highestRank = rank2 > rank1 ? rank2 : rank1;
+    return rank3 > highestRank ? 2 : iWinner;
+}
+
+//@}
+
 #endif //CARD_DEFS_H
 
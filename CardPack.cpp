@@ -1,16 +1,64 @@
 #include "CardPack.h"
 
 #include <algorithm>
+#include <array>
 #include <random>
 
-CCardPack::CCardPack()
+namespace
 {
-    m_iCardsCount = 0;
+
+/// Representative cards table: [outstanding cards][player's cards]
+typedef std::array<std::array<SuitMask, 256>, 256> RepresentativeCardsTable;
+
+/**
+ * @brief Build representative cards table
+ *
+ * Player's card is skipped if the next heigher outstanding card belongs to the player
+ * as well.
+ *
+ * @return the table
+ */
+constexpr RepresentativeCardsTable makeRepresentativeCardsTable()
+{
+    RepresentativeCardsTable table{};
+
+    for(unsigned int outstanding = 0; outstanding < 256; outstanding++)
+        for(unsigned int cards = 0; cards < 256; cards++)
+        {
+            unsigned int res = 0;
+            for(unsigned int bit = 1; bit < 256; bit <<= 1)
+            {
+                if((cards & bit) == 0)
+                    continue;
+
+                // Search for the next outstanding card
+                unsigned int heigher = outstanding & ~(bit | (bit - 1));
+                unsigned int next = heigher & (0 - heigher);
+
+                if((next & cards) == 0)
+                    res |= bit;
+            }
+
+            table[outstanding][cards] = static_cast<SuitMask>(res);
+        }
+
+    return table;
+}
+
+/// Representative cards lookup table (see makeRepresentativeCardsTable())
+constexpr RepresentativeCardsTable REPRESENTATIVE_CARDS = makeRepresentativeCardsTable();
+
+} // namespace
+
+SuitMask getRepresentativeCards(SuitMask cards, SuitMask outstanding)
+{
+    return REPRESENTATIVE_CARDS[outstanding][cards];
 }
 
 CCardPack::CCardPack(const char * cards)
 {
-    m_iCardsCount = 0;
+    m_cards = 0;
+    m_iUnknownCardsCount = 0;
     while(*cards != '\0')
     {
         // Skip white spaces
@@ -18,76 +66,82 @@ CCardPack::CCardPack(const char * cards)
             cards++;
 
         // parse the card
-        m_aCards[m_iCardsCount++] = parseCard(cards);
+        Card card = parseCard(cards);
         cards += 2;
-    }
 
-    // Sort cards, just in case
-    std::sort(m_aCards, m_aCards + m_iCardsCount * sizeof(Card));
-}
+        if(card == UNKNOWN_CARD)
+        {
+            m_iUnknownCardsCount++;
+            continue;
+        }
 
-CCardPack::CCardPack(const CCardPack & rPack)
-{
-    m_iCardsCount = rPack.m_iCardsCount;
-    memcpy(m_aCards, rPack.m_aCards, m_iCardsCount * sizeof(Card));
-}
+        if(!isPreferansCard(card))
+            throw "CCardPack::CCardPack(): Card does not belong to the Preferans deck";
 
-CCardPack::~CCardPack()
-{
-}
-    
-CCardPack & CCardPack::operator=(const CCardPack & rPack)
-{
-    if(this != &rPack)
-    {
-        m_iCardsCount = rPack.m_iCardsCount;
-        memcpy(m_aCards, rPack.m_aCards, m_iCardsCount * sizeof(Card));
-    }	
-    
-    return *this;
+        if(m_cards & getCardBit(card))
+            throw "CCardPack::CCardPack(): Duplicate card";
+
+        m_cards |= getCardBit(card);
+    }
 }
 
 std::string CCardPack::getPackStr() const
 {
     std::string sRes;
 
-    for(unsigned int i=0; i<m_iCardsCount; i++)
+    // Known cards go first (already sorted), then unknown ones
+    for(CardMask cards = m_cards; cards != 0; cards &= cards - 1)
     {
-        char temp[4] = "   ";
-    
-        temp[1] = getCardValueSymb(getCardValue(m_aCards[i]));
-        temp[2] = getSuitSymb(getSuit(m_aCards[i]));
-	
-        sRes.append(std::string(temp));
+        sRes.append(" ");
+        sRes.append(getCardStr(getCardByIdx(getLowestCardIdx(cards))));
     }
-    
+
+    for(unsigned int i=0; i<m_iUnknownCardsCount; i++)
+    {
+        sRes.append(" ");
+        sRes.append(getCardStr(UNKNOWN_CARD));
+    }
+
     return sRes;
 }
 
 CCardPack CCardPack::extractRandomCards(unsigned int size)
 {
-    // Shuffle current card pack
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(m_aCards, m_aCards + m_iCardsCount, g);
+    thread_local CRandomGenerator random(std::random_device{}());
+    return extractRandomCards(size, random);
+}
 
-    // Extract selected number of cards to a new card pack
+CCardPack CCardPack::extractRandomCards(unsigned int size, CRandomGenerator & random)
+{
+    // Unpack cards into array
+    Card aCards[MAX_CARDS];
+    unsigned int iCardsCount = 0;
+    for(CardMask cards = m_cards; cards != 0; cards &= cards - 1)
+        aCards[iCardsCount++] = getCardByIdx(getLowestCardIdx(cards));
+    for(unsigned int i=0; i<m_iUnknownCardsCount; i++)
+        aCards[iCardsCount++] = UNKNOWN_CARD;
+
+    if(size > iCardsCount)
+        size = iCardsCount;
+
+    // Move randomly selected cards to a new card pack. Only selected cards need to be shuffled
     CCardPack newPack;
-    std::copy(m_aCards + m_iCardsCount - size, m_aCards + m_iCardsCount, newPack.m_aCards);
-    newPack.m_iCardsCount = size;
-    m_iCardsCount -= size;
+    for(unsigned int i=iCardsCount; i>iCardsCount - size; i--)
+    {
+        unsigned int j = random.getBounded(i);
+        Card card = aCards[j];
+        aCards[j] = aCards[i - 1];
+        aCards[i - 1] = card;
 
-    // Sort both packs
-    std::sort(m_aCards, m_aCards + m_iCardsCount * sizeof(Card));
-    std::sort(newPack.m_aCards, newPack.m_aCards + size * sizeof(Card));
+        removeCard(card);
 
-    return newPack;
-}
+        if(card == UNKNOWN_CARD)
+            newPack.m_iUnknownCardsCount++;
+        else
+            newPack.m_cards |= getCardBit(card);
+    }
 
-void CCardPack::removeCard(Card card)
-{
-    std::remove(m_aCards, m_aCards + m_iCardsCount, card);
-    m_iCardsCount--;
+    return newPack;
 }
 
 bool CCardPack::areCardsEquivalent(Card left, Card right) const
@@ -96,105 +150,63 @@ bool CCardPack::areCardsEquivalent(Card left, Card right) const
     if(getSuit(left) != getSuit(right))
         return false;
 
-    // Check that provided cards are located next to each other
-    for(unsigned int i=0; i < m_iCardsCount - 1; i++)
-    {
-        if(m_aCards[i] != left && m_aCards[i] != right)
-            continue;
-        
-        if(m_aCards[i+1] == right || m_aCards[i+1] == left)
-            return true;
+    // Unknown cards are never equivalent
+    if(!isPreferansCard(left) || !isPreferansCard(right) || left == right)
+        return false;
 
+    if(right < left)
+        std::swap(left, right);
+
+    // Both cards shall be in the pack
+    CardMask leftBit = getCardBit(left);
+    CardMask rightBit = getCardBit(right);
+    if((m_cards & leftBit) == 0 || (m_cards & rightBit) == 0)
         return false;
-    }
-    
-    return false;
+
+    // Check that provided cards are located next to each other
+    CardMask between = (rightBit - 1) & ~(leftBit | (leftBit - 1));
+    return (m_cards & between) == 0;
 }
 
 void CCardPack::filterOutEquivalentCards(const CCardPack & ref)
 {
     // if the pack contains only 1 card (or 0) - nothing to do with filtering
-    if(m_iCardsCount <= 1)
+    if(getCardsCount() <= 1)
         return;
 
-    unsigned int idx=0;
-    unsigned int refIdx=0;
-    unsigned int targetIdx = 0;
-    do
+    // Equivalent cards can only be of the same suit, so process suits independently
+    CardMask res = 0;
+    for(unsigned int suit = 0; suit < MAX_CARDS; suit += CARDS_IN_SUIT)
     {
-        // Get cards to compare
-        Card card = m_aCards[idx++];
-        Card nextCard = m_aCards[idx];
-
-        // Search for the card in reference deck
-        while(ref.m_aCards[refIdx] != card)
-            refIdx++;
-
-        // Skip equivalent cards
-        if(getSuit(card) == getSuit(nextCard) &&
-           card == ref.m_aCards[refIdx] &&
-           nextCard == ref.m_aCards[refIdx + 1])
-            continue;
-
-        // Store non-equivalent cards
-        m_aCards[targetIdx++] = card;
+        SuitMask cards = static_cast<SuitMask>(m_cards >> suit);
+        SuitMask outstanding = static_cast<SuitMask>(ref.m_cards >> suit);
+        res |= CardMask(REPRESENTATIVE_CARDS[outstanding][cards]) << suit;
     }
-    while(idx < m_iCardsCount - 1);
 
-    // Fill the remaining card
-    m_aCards[targetIdx] = m_aCards[idx];
-    m_iCardsCount = targetIdx + 1;
+    m_cards = res;
 }
 
-CCardPack CCardPack::operator +(const CCardPack &rPack)
+CCardPack CCardPack::operator +(const CCardPack &rPack) const
 {
-    if(m_iCardsCount + rPack.m_iCardsCount > MAX_CARDS)
+    if(getCardsCount() + rPack.getCardsCount() > MAX_CARDS)
         throw "CCardPack::operator+(): Too many cards to combine";
 
-    // Make a copy
-    CCardPack res(*this);
-
-    // Concatenate other pack's array
-    std::copy(rPack.m_aCards, rPack.m_aCards + rPack.m_iCardsCount, res.m_aCards + res.m_iCardsCount);
-    res.m_iCardsCount += rPack.m_iCardsCount;
-
-    // Finally sort the result
-    std::sort(res.m_aCards, res.m_aCards + res.m_iCardsCount);
+    if(m_cards & rPack.m_cards)
+        throw "CCardPack::operator+(): Card packs have common cards";
 
+    CCardPack res;
+    res.m_cards = m_cards | rPack.m_cards;
+    res.m_iUnknownCardsCount = m_iUnknownCardsCount + rPack.m_iUnknownCardsCount;
     return res;
 }
 
-CCardPack CCardPack::operator -(const CCardPack &rPack)
+CCardPack CCardPack::operator -(const CCardPack &rPack) const
 {
     CCardPack res;
+    res.m_cards = m_cards & ~rPack.m_cards;
 
-    // Concatenate other pack's array
-    auto diffIt = std::set_difference(m_aCards, m_aCards + m_iCardsCount,
-                                     rPack.m_aCards, rPack.m_aCards + rPack.m_iCardsCount,
-                                     res.m_aCards);
-    res.m_iCardsCount = diffIt - res.m_aCards;
+    // Each unknown card in reference pack compensates one unknown card in this pack
+    if(m_iUnknownCardsCount > rPack.m_iUnknownCardsCount)
+        res.m_iUnknownCardsCount = m_iUnknownCardsCount - rPack.m_iUnknownCardsCount;
     return res;
 }
-
-CCardPack CCardPack::getSubset(CardSuit suit) const
-{
-    CCardPack ret;
-
-    // If no suit specified - nothing to return
-    if(suit == CS_UNKNOWN)
-        return ret;
-
-    // Copy cards that match given suit
-    unsigned int j = 0;
-    for(unsigned int i=0; i<m_iCardsCount; i++)
-    {
-        if(getSuit(m_aCards[i]) == suit)
-        {
-            ret.m_aCards[j] = m_aCards[i];
-            j++;
-        }
-    }
-
-    ret.m_iCardsCount = j;
-    return ret;
-}
@@ -13,10 +13,25 @@
 #include <cstring>
 
 #include "CardDefs.h"
+#include "Random.h"
 
 /// Maximum number of cards, that can be handled in one pack. For Marraige is 4 suits of 8 cards.
 const unsigned int MAX_CARDS = 4*8;
 
+/**
+ * @brief Filter out equivalent cards of a single suit
+ *
+ * This function is a lookup table for card equivalence filtering. Player's cards are equivalent
+ * if there are no other outstanding cards of the suit between them, thus only the heighest card
+ * of each group of equivalent cards is a representative move.
+ *
+ * @param cards         - player's cards of the suit
+ * @param outstanding   - all cards of the suit still in game (including player's cards)
+ *
+ * @return player's cards with equivalent cards filtered out
+ */
+SuitMask getRepresentativeCards(SuitMask cards, SuitMask outstanding);
+
 /**
  * @brief The Cards Pack class
  *
@@ -27,11 +42,13 @@ const unsigned int MAX_CARDS = 4*8;
  * The only operation is allowed to modify the card pack is remove specified card from a pack. Thus
  * there is no public empty constructor for this class.
  *
- * Class handles the cards array as simple array of fixed size to provide maximum performace.
+ * Class handles the cards as a bit mask (one bit per card of the Preferans deck) to provide
+ * maximum performance: most of the operations turn into a few bit operations.
  *
- * @note It is assumed, that handled array of cards is always sorted.
+ * @note Cards are always enumerated in sorted order (by suit, then by value)
  * @note The class can handle unknown cards. They are treated as playholders for real cards
- *       that may be calculated later
+ *       that may be calculated later. Unknown cards are just counted and always go after
+ *       known cards.
  */
 class CCardPack
 {
@@ -42,7 +59,11 @@ private:
      *
      * This constructor will create an empty cards pack
      */
-    CCardPack();
+    CCardPack()
+        : m_cards(0)
+        , m_iUnknownCardsCount(0)
+    {
+    }
 
 public:    
     /**
@@ -55,6 +76,19 @@ public:
      */
     CCardPack(const char * cards);
 
+    /**
+     * @brief Cards Pack constructor (from card mask)
+     *
+     * This constructor will create cards pack with cards specified in the mask
+     *
+     * @param cards     - mask of cards
+     */
+    explicit CCardPack(CardMask cards)
+        : m_cards(cards)
+        , m_iUnknownCardsCount(0)
+    {
+    }
+
     /**
      * @brief Cards Pack copy constructor
      *
@@ -62,13 +96,13 @@ public:
      *
      * @param rPack - the source cards pack
      */
-    CCardPack(const CCardPack & rPack);
+    CCardPack(const CCardPack & rPack) = default;
     /**
      * @brief Cards Pack destructor
      *
-     * This destructor will free handled array.
+     * This destructor does nothing, as there is no data to free.
      */
-    ~CCardPack();
+    ~CCardPack() = default;
 
 ///@name Operators
 //@{
@@ -82,7 +116,7 @@ public:
      *
      * @return the copied cards pack
      */    
-    CCardPack & operator=(const CCardPack & rPack);
+    CCardPack & operator=(const CCardPack & rPack) = default;
     
     /**
      * @brief less than operator
@@ -98,20 +132,12 @@ public:
      */
     inline bool operator<(const CCardPack & rPack) const
     {
-        if(m_iCardsCount < rPack.m_iCardsCount)
+        if(m_iUnknownCardsCount < rPack.m_iUnknownCardsCount)
             return true;
-        if(rPack.m_iCardsCount < m_iCardsCount)
+        if(rPack.m_iUnknownCardsCount < m_iUnknownCardsCount)
             return false;
-    
-        for(unsigned int i=0; i<m_iCardsCount; i++)
-        {
-            if(m_aCards[i] < rPack.m_aCards[i])
-                return true;
-            if(rPack.m_aCards[i] < m_aCards[i])
-                return false;
-        }
-        
-        return false;
+
+        return m_cards < rPack.m_cards;
     }
 
     /**
@@ -125,8 +151,8 @@ public:
      */
     inline bool operator==(const CCardPack & rPack) const
     {
-        return m_iCardsCount == rPack.m_iCardsCount &&
-                memcmp(m_aCards, rPack.m_aCards, m_iCardsCount) == 0;
+        return m_cards == rPack.m_cards &&
+               m_iUnknownCardsCount == rPack.m_iUnknownCardsCount;
     }
 
     /// Serialization operator. It stores the cards pack as a string (each card separated by space) to the stream.
@@ -141,8 +167,6 @@ public:
      *
      * This operator is intended for combination of two card packs (union).
      *
-     * Algorithm assumes, that both card pack are sorted, resulting card pack will be also sorted.
-     *
      * @throw "const char *" exception if cards from both packs cannot fit in one pack, or if one card is found
      * in two card packs (thus, input card packs shall have different cards to combine)
      *
@@ -150,20 +174,18 @@ public:
      *
      * @return The combined card pack
      */
-    CCardPack operator +(const CCardPack &rPack);
+    CCardPack operator +(const CCardPack &rPack) const;
 
     /**
      * @brief Subtraction operator
      *
      * This operator is intended for removing elements that are present in the reference pack.
      *
-     * Algorithm assumes, that both card pack are sorted, resulting card pack will be also sorted.
-     *
      * @param rPack - card pack to be subtracted from current card pack
      *
      * @return The pack containing only those elements, that were not present in the reference card pack
      */
-    CCardPack operator -(const CCardPack &rPack);
+    CCardPack operator -(const CCardPack &rPack) const;
 //@}
 
 ///@name Data retrieving operators
@@ -188,15 +210,28 @@ public:
      */
     inline unsigned int getCardsCount() const
     {
-        return m_iCardsCount;
+        return countCards(m_cards) + m_iUnknownCardsCount;
     }
-    
+
+    /**
+     * @brief Retrieve the mask of known cards
+     *
+     * This method is intended for fast iteration over the cards, and bulk card operations
+     *
+     * @return mask of the known cards in the pack
+     */
+    inline CardMask getCardsMask() const
+    {
+        return m_cards;
+    }
+
     /**
      * @brief Retrieve the card by index
      *
      * This method is intended for retrieving the card by specified index
      *
-     * @note Index bounds are not checked
+     * @note Index bounds are not checked. Cards are sorted, unknown cards go last.
+     * @note Access by index takes linear time, use getCardsMask() for iterating over cards.
      *
      * @param idx   - index of the card to be retrieved
      *
@@ -204,7 +239,16 @@ public:
      */
     inline Card getCard(unsigned int idx) const
     {
-        return m_aCards[idx];
+        // Unknown cards are located after known ones
+        if(idx >= countCards(m_cards))
+            return UNKNOWN_CARD;
+
+        // Skip idx lowest cards
+        CardMask cards = m_cards;
+        for(; idx > 0; idx--)
+            cards &= cards - 1;
+
+        return getCardByIdx(getLowestCardIdx(cards));
     }
 
     /**
@@ -216,12 +260,10 @@ public:
      */
     inline bool hasCard(Card card) const
     {
-        for(unsigned int i=0; i<m_iCardsCount; i++)
-        {
-            if(m_aCards[i] == card)
-                return true;
-        }
-        return false;
+        if(card == UNKNOWN_CARD)
+            return m_iUnknownCardsCount > 0;
+
+        return isPreferansCard(card) && (m_cards & getCardBit(card)) != 0;
     }
 
     /**
@@ -237,13 +279,7 @@ public:
         if(suit == CS_UNKNOWN)
             return false;
 
-        // Just search for the requested suit
-        for(unsigned int i=0; i<m_iCardsCount; i++)
-        {
-            if(getSuit(m_aCards[i]) == suit)
-                return true;
-        }
-        return false;
+        return (m_cards & getSuitCardsMask(suit)) != 0;
     }
 
     /**
@@ -253,13 +289,7 @@ public:
      */
     inline bool hasUnknownCards() const
     {
-        // Just search for unknown cards
-        for(unsigned int i=0; i<m_iCardsCount; i++)
-        {
-            if(m_aCards[i] == UNKNOWN_CARD)
-                return true;
-        }
-        return false;
+        return m_iUnknownCardsCount > 0;
     }
 
     /**
@@ -269,8 +299,6 @@ public:
      * and there is no other card, that heigher than left card and less than right. In terms of sorted cards array
      * This cards will be located in two neighbor cells.
      *
-     * It is assumed, that cards array is sorted and specified left card is less than right.
-     *
      * @param left  - left compared card
      * @param right - right compared card
      *
@@ -289,6 +317,8 @@ public:
      * Extracted cards are removed from current deck
      *
      * @note both decks get sorted
+     * @note Cards are selected with a per-thread generator seeded once from std::random_device,
+     *       use the overload with explicit generator to get reproducible results
      *
      * @param size  - number of cards to extract
      *
@@ -296,6 +326,16 @@ public:
      */
     CCardPack extractRandomCards(unsigned int size);
 
+    /**
+     * @brief random split the deck (with the given random numbers generator)
+     *
+     * @param size      - number of cards to extract
+     * @param random    - random numbers generator to use
+     *
+     * @return a new pack containing extracted cards
+     */
+    CCardPack extractRandomCards(unsigned int size, CRandomGenerator & random);
+
     /**
      * @brief Remove card
      *
@@ -305,7 +345,16 @@ public:
      *
      * @param card - card to be removed
      */
-    void removeCard(Card card);
+    inline void removeCard(Card card)
+    {
+        if(card == UNKNOWN_CARD)
+        {
+            if(m_iUnknownCardsCount > 0)
+                m_iUnknownCardsCount--;
+        }
+        else if(isPreferansCard(card))
+            m_cards &= ~getCardBit(card);
+    }
 
     /**
      * @brief return a subset of cards that match the given suit
@@ -314,26 +363,36 @@ public:
      *
      * @param suit - the suit to include into a resulting subset
      */
-    CCardPack getSubset(CardSuit suit) const;
+    inline CCardPack getSubset(CardSuit suit) const
+    {
+        // If no suit specified - nothing to return
+        if(suit == CS_UNKNOWN)
+            return CCardPack();
+
+        // Copy cards that match given suit
+        return CCardPack(m_cards & getSuitCardsMask(suit));
+    }
 
     /**
      * @brief filter out equivalent cards
      *
      * This method filters out cards that have the same value in the given reference
      * card pack. Cards are equivalent if they are located contiguously in the reference
-     * pack.
+     * pack. Only the heighest card of each group of equivalent cards remains.
      *
-     * @param suit - the suit to include into a resulting subset
+     * Filtering is done suit by suit using getRepresentativeCards() lookup table.
+     *
+     * @param ref - the reference card pack (all cards in game)
      */
     void filterOutEquivalentCards(const CCardPack & ref);
 
 //@}
 
 protected:
-    /// The cards array
-    Card m_aCards[MAX_CARDS];
-    /// Current number of cards in handled array
-    unsigned int m_iCardsCount;
+    /// Known cards, one bit per card
+    CardMask m_cards;
+    /// Number of unknown cards
+    unsigned int m_iUnknownCardsCount;
 };
 
 #endif // CARD_PACK_H
@@ -0,0 +1,93 @@
+#ifndef DEAL_H
+#define DEAL_H
+
+/**
+ * @file
+ * @brief The deal definition
+ */
+
+#include <string>
+
+#include "CardDefs.h"
+#include "CardPack.h"
+#include "Score.h"
+
+/// Number of cards dealt to each player
+const unsigned int HAND_SIZE = 10;
+
+/// Number of cards in the talon
+const unsigned int TALON_SIZE = 2;
+
+/**
+ * @brief The deal
+ *
+ * This is a packed representation of a single deal: cards of each player and talon cards,
+ * each stored as a card mask. A complete Preferans deal is 10/10/10/2 cards, but partial
+ * deals (e.g. endgames, or deals without talon) can be represented as well.
+ *
+ * The structure is trivially copyable, so that deals can be handled in big batches.
+ */
+struct Deal
+{
+    /// Players' cards
+    CardMask m_aHands[MAX_PLAYERS];
+    /// Talon cards
+    CardMask m_talon;
+
+    /**
+     * @brief Retrieve all dealt cards
+     *
+     * @return mask of cards of all hands and talon
+     */
+    inline CardMask getAllCards() const
+    {
+        return m_aHands[0] | m_aHands[1] | m_aHands[2] | m_talon;
+    }
+
+    /**
+     * @brief Check whether the deal is complete
+     *
+     * @return \a true if deal is a complete 10/10/10/2 Preferans deal without duplicates
+     */
+    inline bool isComplete() const
+    {
+        return countCards(m_aHands[0]) == HAND_SIZE &&
+               countCards(m_aHands[1]) == HAND_SIZE &&
+               countCards(m_aHands[2]) == HAND_SIZE &&
+               countCards(m_talon) == TALON_SIZE &&
+               countCards(getAllCards()) == MAX_CARDS;
+    }
+
+    /**
+     * @brief Equivalence operator
+     *
+     * @param rDeal - deal to compare with
+     *
+     * @return \a true if deals are equal
+     */
+    inline bool operator==(const Deal & rDeal) const
+    {
+        return m_aHands[0] == rDeal.m_aHands[0] &&
+               m_aHands[1] == rDeal.m_aHands[1] &&
+               m_aHands[2] == rDeal.m_aHands[2] &&
+               m_talon == rDeal.m_talon;
+    }
+
+    /**
+     * @brief Retrieve string representation of the deal
+     *
+     * The deal is printed in the same format it is parsed by CDealParser: hands and talon
+     * separated with '|' symbol.
+     *
+     * @return deal string
+     */
+    inline std::string getDealStr() const
+    {
+        return CCardPack(m_aHands[0]).getPackStr() + " |" +
+               CCardPack(m_aHands[1]).getPackStr() + " |" +
+               CCardPack(m_aHands[2]).getPackStr() + " |" +
+               CCardPack(m_talon).getPackStr();
+    }
+};
+
+#endif // DEAL_H
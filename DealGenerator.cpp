@@ -0,0 +1,54 @@
+#include "DealGenerator.h"
+
+CDealGenerator::CDealGenerator(uint64_t seed, uint64_t stream)
+    : m_random(seed, stream)
+{
+    for(unsigned int i = 0; i < MAX_CARDS; i++)
+        m_aDeck[i] = static_cast<unsigned char>(i);
+}
+
+void CDealGenerator::generateDeal(Deal & deal)
+{
+    // Shuffle all positions except for the 2 lowest ones, these are talon cards,
+    // and their order does not matter. Positions are processed in pairs, so that
+    // a single random number is needed for 2 positions
+    static_assert((MAX_CARDS - TALON_SIZE) % 2 == 0, "Shuffled positions shall go in pairs");
+    for(unsigned int i = MAX_CARDS - 1; i >= TALON_SIZE; i -= 2)
+    {
+        uint32_t j1, j2;
+        m_random.getBoundedPair(i + 1, i, j1, j2);
+
+        unsigned char card = m_aDeck[i];
+        m_aDeck[i] = m_aDeck[j1];
+        m_aDeck[j1] = card;
+
+        card = m_aDeck[i - 1];
+        m_aDeck[i - 1] = m_aDeck[j2];
+        m_aDeck[j2] = card;
+    }
+
+    const unsigned char * pCards = m_aDeck + TALON_SIZE;
+    for(unsigned int iPlayer = 0; iPlayer < MAX_PLAYERS; iPlayer++)
+    {
+        CardMask hand = 0;
+        for(unsigned int i = 0; i < HAND_SIZE; i++)
+            hand |= CardMask(1) << *pCards++;
+
+        deal.m_aHands[iPlayer] = hand;
+    }
+
+    deal.m_talon = (CardMask(1) << m_aDeck[0]) | (CardMask(1) << m_aDeck[1]);
+}
+
+void CDealGenerator::generateDeals(Deal * pDeals, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+        generateDeal(pDeals[i]);
+}
+
+void CDealGenerator::generateDeals(size_t count, std::vector<Deal> & deals)
+{
+    size_t iFirst = deals.size();
+    deals.resize(iFirst + count);
+    generateDeals(deals.data() + iFirst, count);
+}
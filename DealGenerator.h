@@ -0,0 +1,71 @@
+#ifndef DEAL_GENERATOR_H
+#define DEAL_GENERATOR_H
+
+/**
+ * @file
+ * @brief Random deal generator declaration
+ */
+
+#include <vector>
+
+#include "Deal.h"
+#include "Random.h"
+
+/**
+ * @brief Random deal generator
+ *
+ * This class is intended for generating big amounts of random complete 10/10/10/2 deals
+ * (e.g. for Monte Carlo simulations, or test corpus generation).
+ *
+ * Generated deals are completely defined by the seed and the stream index, so that results
+ * can be reproduced. Generators with the same seed and different streams produce independent
+ * sequences of deals, so each worker thread shall have its own stream.
+ *
+ * Deals are made with Fisher-Yates shuffle of the deck. The deck is not reset between deals,
+ * as shuffling of any permutation gives a uniformly distributed one.
+ */
+class CDealGenerator
+{
+public:
+    /**
+     * @brief Create a generator
+     *
+     * @param seed      - generator seed
+     * @param stream    - zero based index of the stream
+     */
+    CDealGenerator(uint64_t seed, uint64_t stream = 0);
+
+    /**
+     * @brief Generate a single deal
+     *
+     * @param deal  - generated deal
+     */
+    void generateDeal(Deal & deal);
+
+    /**
+     * @brief Generate a batch of deals
+     *
+     * @param pDeals    - array to store deals to
+     * @param count     - number of deals to generate
+     */
+    void generateDeals(Deal * pDeals, size_t count);
+
+    /**
+     * @brief Generate a batch of deals
+     *
+     * Generated deals are appended to the given vector
+     *
+     * @param count     - number of deals to generate
+     * @param deals     - vector to append deals to
+     */
+    void generateDeals(size_t count, std::vector<Deal> & deals);
+
+protected:
+    /// Random numbers generator
+    CRandomGenerator m_random;
+
+    /// The deck (card indexes) in the order of the last deal
+    unsigned char m_aDeck[MAX_CARDS];
+};
+
+#endif // DEAL_GENERATOR_H
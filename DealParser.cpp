@@ -0,0 +1,205 @@
+#include "DealParser.h"
+
+#include <array>
+#include <cstring>
+
+namespace
+{
+
+///@name Symbol classes in deal lines
+//@{
+/// White space
+const unsigned char DEAL_SYMB_SPACE = 0x40;
+/// Hands separator
+const unsigned char DEAL_SYMB_SEPARATOR = 0x41;
+/// Card symbol, that does not belong to the Preferans deck
+const unsigned char DEAL_SYMB_NOT_PREFERANS = 0x42;
+/// Hands separator character
+const char DEAL_SEPARATOR = '|';
+/// Comment line character
+const char DEAL_COMMENT = '#';
+//@}
+
+/**
+ * @brief Build a lookup table for the first symbol of the card
+ *
+ * @return table that maps symbol to card value offset from 7 (0..7), or one of symbol
+ *         classes, or INVALID_SYMB
+ */
+constexpr SymbTable makeDealValueTable()
+{
+    SymbTable table{};
+    for(unsigned int c = 0; c < table.size(); c++)
+    {
+        unsigned char value = CARD_VALUE_SYMB_TABLE[c];
+        if(value == INVALID_SYMB)
+            table[c] = INVALID_SYMB;
+        else if(value >= CV_7 && value <= CV_ACE)
+            table[c] = static_cast<unsigned char>(value - CV_7);
+        else
+            table[c] = DEAL_SYMB_NOT_PREFERANS;
+    }
+
+    table[static_cast<unsigned char>(' ')] = DEAL_SYMB_SPACE;
+    table[static_cast<unsigned char>('\t')] = DEAL_SYMB_SPACE;
+    table[static_cast<unsigned char>('\r')] = DEAL_SYMB_SPACE;
+    table[static_cast<unsigned char>(DEAL_SEPARATOR)] = DEAL_SYMB_SEPARATOR;
+    return table;
+}
+
+/**
+ * @brief Build a lookup table for the second symbol of the card
+ *
+ * @return table that maps symbol to the index of the first card of the suit in card mask,
+ *         DEAL_SYMB_NOT_PREFERANS for unknown suit, or INVALID_SYMB
+ */
+constexpr SymbTable makeDealSuitTable()
+{
+    SymbTable table{};
+    for(unsigned int c = 0; c < table.size(); c++)
+    {
+        unsigned char suit = SUIT_SYMB_TABLE[c];
+        if(suit == INVALID_SYMB)
+            table[c] = INVALID_SYMB;
+        else if(suit == CS_UNKNOWN)
+            table[c] = DEAL_SYMB_NOT_PREFERANS;
+        else
+            table[c] = static_cast<unsigned char>((suit >> 4) * CARDS_IN_SUIT);
+    }
+
+    return table;
+}
+
+/// Lookup table for the first card symbol (see makeDealValueTable())
+constexpr SymbTable DEAL_VALUE_TABLE = makeDealValueTable();
+/// Lookup table for the second card symbol (see makeDealSuitTable())
+constexpr SymbTable DEAL_SUIT_TABLE = makeDealSuitTable();
+
+/**
+ * @brief Check whether the line shall be skipped
+ *
+ * @param line  - line to check
+ * @param size  - line length
+ *
+ * @return \a true if line is empty, has only white spaces, or is a comment
+ */
+inline bool isEmptyLine(const char * line, size_t size)
+{
+    for(size_t i = 0; i < size; i++)
+    {
+        if(DEAL_VALUE_TABLE[static_cast<unsigned char>(line[i])] != DEAL_SYMB_SPACE)
+            return line[i] == DEAL_COMMENT;
+    }
+
+    return true;
+}
+
+} // namespace
+
+CDealParser::CDealParser()
+    : m_iLinesCount(0)
+{
+}
+
+DealParseStatus CDealParser::parseDeal(const char * line, size_t size, Deal & deal)
+{
+    // Hands and talon
+    CardMask aHands[MAX_PLAYERS + 1] = {0, 0, 0, 0};
+    CardMask allCards = 0;
+    unsigned int iHand = 0;
+
+    const char * end = line + size;
+    while(line < end)
+    {
+        unsigned char value = DEAL_VALUE_TABLE[static_cast<unsigned char>(*line)];
+
+        // Regular card (the most frequent case)
+        if(value < CARDS_IN_SUIT)
+        {
+            if(line + 1 == end)
+                return DPS_BAD_CARD;
+
+            unsigned char suit = DEAL_SUIT_TABLE[static_cast<unsigned char>(line[1])];
+            if(suit == INVALID_SYMB)
+                return DPS_BAD_CARD;
+            if(suit == DEAL_SYMB_NOT_PREFERANS)
+                return DPS_NOT_PREFERANS_CARD;
+
+            CardMask bit = CardMask(1) << (suit + value);
+            if(allCards & bit)
+                return DPS_DUPLICATE_CARD;
+
+            allCards |= bit;
+            aHands[iHand] |= bit;
+            line += 2;
+            continue;
+        }
+
+        switch(value)
+        {
+        case DEAL_SYMB_SPACE:
+            break;
+
+        case DEAL_SYMB_SEPARATOR:
+            if(++iHand > MAX_PLAYERS)
+                return DPS_BAD_HANDS_COUNT;
+            break;
+
+        case DEAL_SYMB_NOT_PREFERANS:
+            // Recognized card, that cannot be used in Preferans, or just a bad symbol
+            if(line + 1 == end || DEAL_SUIT_TABLE[static_cast<unsigned char>(line[1])] == INVALID_SYMB)
+                return DPS_BAD_CARD;
+            return DPS_NOT_PREFERANS_CARD;
+
+        default:
+            return DPS_BAD_CARD;
+        }
+
+        line++;
+    }
+
+    // Talon is optional, but all players' hands are required
+    if(iHand < MAX_PLAYERS - 1)
+        return DPS_BAD_HANDS_COUNT;
+
+    deal.m_aHands[0] = aHands[0];
+    deal.m_aHands[1] = aHands[1];
+    deal.m_aHands[2] = aHands[2];
+    deal.m_talon = aHands[MAX_PLAYERS];
+    return DPS_OK;
+}
+
+size_t CDealParser::parseDeals(const char * buf, size_t size, std::vector<Deal> & deals)
+{
+    size_t iParsed = 0;
+    const char * end = buf + size;
+
+    while(buf < end)
+    {
+        // Search for the line end
+        const char * lineEnd = static_cast<const char *>(memchr(buf, '\n', end - buf));
+        if(lineEnd == nullptr)
+            lineEnd = end;
+
+        size_t lineSize = lineEnd - buf;
+        m_iLinesCount++;
+
+        if(!isEmptyLine(buf, lineSize))
+        {
+            Deal deal;
+            DealParseStatus status = parseDeal(buf, lineSize, deal);
+            if(status == DPS_OK)
+            {
+                deals.push_back(deal);
+                iParsed++;
+            }
+            else
+                m_errors.push_back(DealParseError{m_iLinesCount, status});
+        }
+
+        // The last line may have no line end
+        buf = (lineEnd == end) ? end : lineEnd + 1;
+    }
+
+    return iParsed;
+}
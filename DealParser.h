@@ -0,0 +1,109 @@
+#ifndef DEAL_PARSER_H
+#define DEAL_PARSER_H
+
+/**
+ * @file
+ * @brief Bulk deal parser declaration
+ */
+
+#include <vector>
+
+#include "Deal.h"
+
+/// Deal parsing status
+enum DealParseStatus
+{
+    /// Deal parsed successfully
+    DPS_OK = 0,
+    /// Unrecognized card or symbol in the line
+    DPS_BAD_CARD,
+    /// Card is not a card of the Preferans deck (or it is an unknown card)
+    DPS_NOT_PREFERANS_CARD,
+    /// The same card is found twice in the deal
+    DPS_DUPLICATE_CARD,
+    /// Wrong number of hands (3 hands are expected, with optional talon)
+    DPS_BAD_HANDS_COUNT
+};
+
+/**
+ * @brief Deal parse error
+ *
+ * This structure describes a single line of the buffer that failed to parse
+ */
+struct DealParseError
+{
+    /// One based line number in the parsed buffer
+    size_t m_iLine;
+    /// Parsing status
+    DealParseStatus m_status;
+};
+
+/**
+ * @brief Bulk deal parser
+ *
+ * This class is intended for fast parsing of big text buffers with deals (one deal per line)
+ * into packed Deal objects.
+ *
+ * Line format is the following:
+ * @code
+ * <player 1 cards> | <player 2 cards> | <player 3 cards> [| <talon cards>]
+ * @endcode
+ * Cards are written in the same notation as for CCardPack (e.g. "7^ 1+ A@"), separated by
+ * spaces or tabs. Empty lines and lines starting with '#' are skipped.
+ *
+ * Unlike CCardPack string constructor, this parser does not throw exceptions. Lines that
+ * fail to parse are skipped and reported with DealParseError records.
+ */
+class CDealParser
+{
+public:
+    /**
+     * @brief Create a parser
+     */
+    CDealParser();
+
+    /**
+     * @brief Parse a single deal line
+     *
+     * @param line  - line to parse (no line breaks expected)
+     * @param size  - line length
+     * @param deal  - parsed deal (undefined if parsing fails)
+     *
+     * @return parsing status
+     */
+    static DealParseStatus parseDeal(const char * line, size_t size, Deal & deal);
+
+    /**
+     * @brief Parse a buffer of deal lines
+     *
+     * Parsed deals are appended to the given vector, errors are stored in the parser (see
+     * getErrors()). Line numbers are counted across subsequent calls, so that a big file
+     * can be parsed in chunks, as long as chunks are split at line boundaries.
+     *
+     * @param buf   - buffer to parse
+     * @param size  - buffer size
+     * @param deals - vector to append parsed deals to
+     *
+     * @return number of successfully parsed deals
+     */
+    size_t parseDeals(const char * buf, size_t size, std::vector<Deal> & deals);
+
+    /**
+     * @brief Retrieve parse errors
+     *
+     * @return list of lines that failed to parse
+     */
+    const std::vector<DealParseError> & getErrors() const
+    {
+        return m_errors;
+    }
+
+protected:
+    /// Number of lines processed so far
+    size_t m_iLinesCount;
+
+    /// List of parse errors
+    std::vector<DealParseError> m_errors;
+};
+
+#endif // DEAL_PARSER_H
@@ -0,0 +1,166 @@
+#include "DealRanker.h"
+
+#include <array>
+
+namespace
+{
+
+/// Binomial coefficients table: [n][k]
+typedef std::array<std::array<DealRank, MAX_CARDS + 1>, MAX_CARDS + 1> BinomialsTable;
+
+/**
+ * @brief Build binomial coefficients table
+ *
+ * @return the table, where coefficients for k > n are zero
+ */
+constexpr BinomialsTable makeBinomialsTable()
+{
+    BinomialsTable table{};
+
+    for(unsigned int n = 0; n <= MAX_CARDS; n++)
+    {
+        table[n][0] = 1;
+        for(unsigned int k = 1; k <= n; k++)
+            table[n][k] = table[n - 1][k - 1] + table[n - 1][k];
+    }
+
+    return table;
+}
+
+/// Binomial coefficients lookup table (see makeBinomialsTable())
+constexpr BinomialsTable BINOMIALS = makeBinomialsTable();
+
+/**
+ * @brief Calculate the rank of the cards combination
+ *
+ * Cards are numbered by their position among the available cards, and the combination
+ * is ranked in colexicographical order.
+ *
+ * @param cards     - cards combination
+ * @param available - cards, the combination is selected from
+ *
+ * @return the combination rank
+ */
+inline DealRank rankCombination(CardMask cards, CardMask available)
+{
+    DealRank rank = 0;
+    unsigned int k = 1;
+    for(; cards != 0; cards &= cards - 1)
+    {
+        CardMask bit = cards & (0 - cards);
+        rank += BINOMIALS[countCards(available & (bit - 1))][k++];
+    }
+
+    return rank;
+}
+
+/**
+ * @brief Restore the cards combination by its rank
+ *
+ * @param rank      - the combination rank (see rankCombination())
+ * @param count     - number of cards in the combination
+ * @param available - cards, the combination is selected from
+ *
+ * @return cards combination
+ */
+inline CardMask unrankCombination(DealRank rank, unsigned int count, CardMask available)
+{
+    CardMask cards = 0;
+    CardMask card = 0;
+    unsigned int pos = countCards(available);
+    for(unsigned int k = count; k > 0; k--)
+    {
+        // Search for the highest position, that fits the rank. Positions go down,
+        // so available cards are walked from the highest one
+        do
+        {
+            pos--;
+            card = CardMask(1) << getHighestCardIdx(available);
+            available &= ~card;
+        }
+        while(BINOMIALS[pos][k] > rank);
+
+        rank -= BINOMIALS[pos][k];
+        cards |= card;
+    }
+
+    return cards;
+}
+
+} // namespace
+
+CDealRanker::CDealRanker()
+{
+    init(Deal{{0, 0, 0}, 0});
+}
+
+CDealRanker::CDealRanker(const Deal & known)
+{
+    init(known);
+}
+
+void CDealRanker::init(const Deal & known)
+{
+    CardMask allCards = getSuitCardsMask(CS_SPIDES) | getSuitCardsMask(CS_CLUBS) |
+                        getSuitCardsMask(CS_DIAMONDS) | getSuitCardsMask(CS_HEARTS);
+    unsigned int iKnownCount = countCards(known.m_aHands[0]) + countCards(known.m_aHands[1]) +
+                               countCards(known.m_aHands[2]) + countCards(known.m_talon);
+
+    if(iKnownCount != countCards(known.getAllCards()))
+        throw "CDealRanker::CDealRanker(): Known cards are duplicated";
+
+    if(countCards(known.m_talon) > TALON_SIZE)
+        throw "CDealRanker::CDealRanker(): Too many known talon cards";
+
+    m_known = known;
+    m_unknownCards = allCards & ~known.getAllCards();
+    m_iDealsCount = 1;
+
+    unsigned int iAvailableCount = countCards(m_unknownCards);
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+    {
+        if(countCards(known.m_aHands[i]) > HAND_SIZE)
+            throw "CDealRanker::CDealRanker(): Too many known cards of the player";
+
+        m_aUnknownCounts[i] = HAND_SIZE - countCards(known.m_aHands[i]);
+        m_aRadixes[i] = BINOMIALS[iAvailableCount][m_aUnknownCounts[i]];
+        m_iDealsCount *= m_aRadixes[i];
+        iAvailableCount -= m_aUnknownCounts[i];
+    }
+}
+
+DealRank CDealRanker::rankDeal(const Deal & deal) const
+{
+    DealRank rank = 0;
+    CardMask available = m_unknownCards;
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+    {
+        CardMask cards = deal.m_aHands[i] & ~m_known.m_aHands[i];
+        rank = rank * m_aRadixes[i] + rankCombination(cards, available);
+        available &= ~cards;
+    }
+
+    return rank;
+}
+
+void CDealRanker::unrankDeal(DealRank rank, Deal & deal) const
+{
+    // Split rank into hand ranks, the last hand is the lowest digit
+    DealRank aRanks[MAX_PLAYERS];
+    for(unsigned int i = MAX_PLAYERS; i > 0; i--)
+    {
+        aRanks[i - 1] = rank % m_aRadixes[i - 1];
+        rank /= m_aRadixes[i - 1];
+    }
+
+    CardMask available = m_unknownCards;
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+    {
+        CardMask cards = unrankCombination(aRanks[i], m_aUnknownCounts[i], available);
+        deal.m_aHands[i] = m_known.m_aHands[i] | cards;
+        available &= ~cards;
+    }
+
+    // Talon gets the rest
+    deal.m_talon = m_known.m_talon | available;
+}
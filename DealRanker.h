@@ -0,0 +1,104 @@
+#ifndef DEAL_RANKER_H
+#define DEAL_RANKER_H
+
+/**
+ * @file
+ * @brief Deal ranking declaration
+ */
+
+#include <cstdint>
+
+#include "Deal.h"
+
+/// Typedef for deal rank (dense index of the deal, see CDealRanker)
+typedef uint64_t DealRank;
+
+/**
+ * @brief Deal ranker
+ *
+ * This class maps deals to dense integer indexes (ranks) and back. Ranks go from zero to
+ * getDealsCount() - 1 without gaps, so that:
+ * - a deal can be stored as a single 64 bit number
+ * - all deals can be enumerated with a simple counter loop, that can be easily split into
+ *   ranges between workers
+ * - results can be stored in flat arrays indexed by deal rank
+ * .
+ *
+ * Ranker works with a space of deals, that are consistent with the known cards: known cards
+ * always stay at their places, and all the other cards are distributed so that each player
+ * gets HAND_SIZE cards, and talon gets TALON_SIZE cards. Without known cards all complete
+ * Preferans deals are ranked.
+ *
+ * Ranking uses the combinatorial number system: unknown cards of each hand are ranked
+ * as a combination of cards that are still not dealt to previous hands, and hand ranks
+ * are combined as digits of a mixed radix number. Talon gets what is left.
+ */
+class CDealRanker
+{
+public:
+    /**
+     * @brief Create ranker for all complete deals
+     */
+    CDealRanker();
+
+    /**
+     * @brief Create ranker for deals, consistent with known cards
+     *
+     * @throw "const char *" exception if known cards cannot be a part of a complete deal
+     *
+     * @param known - known cards of players and talon
+     */
+    CDealRanker(const Deal & known);
+
+    /**
+     * @brief Retrieve number of deals
+     *
+     * @return number of deals consistent with known cards
+     */
+    inline DealRank getDealsCount() const
+    {
+        return m_iDealsCount;
+    }
+
+    /**
+     * @brief Calculate the deal rank
+     *
+     * @note The deal is not checked, it shall be a complete deal consistent with known cards
+     *
+     * @param deal  - the deal
+     *
+     * @return the deal rank
+     */
+    DealRank rankDeal(const Deal & deal) const;
+
+    /**
+     * @brief Restore the deal by its rank
+     *
+     * @note The rank is not checked, it shall be less than getDealsCount()
+     *
+     * @param rank  - the deal rank
+     * @param deal  - restored deal
+     */
+    void unrankDeal(DealRank rank, Deal & deal) const;
+
+protected:
+    /**
+     * @brief Initialize ranker for the given known cards
+     *
+     * @param known - known cards of players and talon
+     */
+    void init(const Deal & known);
+
+    /// Known cards
+    Deal m_known;
+    /// Cards that are not known
+    CardMask m_unknownCards;
+    /// Number of unknown cards for each player
+    unsigned int m_aUnknownCounts[MAX_PLAYERS];
+    /// Number of possible combinations of unknown cards for each player (radix of the hand rank)
+    DealRank m_aRadixes[MAX_PLAYERS];
+    /// Total number of deals
+    DealRank m_iDealsCount;
+};
+
+#endif // DEAL_RANKER_H
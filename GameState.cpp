@@ -1,135 +1,158 @@
 #include "GameState.h"
 #include "VisitedStateCache.h"
+#include "MoveOrdering.h"
+#include "Deal.h"
 
+#include <algorithm>
 #include <map>
 #include <sstream>
 
-CGameState::CGameState(const CPlayer & p1, const CPlayer & p2, const CPlayer & p3)
-    : m_score()
-    , m_pCardsLeft(nullptr)
-    , m_bOwnsCardsLeft(false)
+namespace
 {
-    m_aPlayers[0] = new CPlayer(p1);
-    m_aPlayers[1] = new CPlayer(p2);
-    m_aPlayers[2] = new CPlayer(p3);
-    
-    m_trumpSuit = CS_UNKNOWN;
-    m_currentSuit = CS_UNKNOWN;
-    m_iActivePlayer = 0;
-    
-    m_iCardsOnTableCount = 0;
 
-    m_pCache = nullptr;
+/**
+ * @brief Count top cards of the suit in the hand
+ *
+ * Top cards are the hand cards, that are higher than any card of the suit in other hands
+ *
+ * @param hand  - hand cards of the suit
+ * @param cards - all cards of the suit left in the game
+ *
+ * @return number of top cards
+ */
+inline unsigned int countTopCards(SuitMask hand, SuitMask cards)
+{
+    SuitMask others = cards & ~hand;
+    if(others == 0)
+        return countCards(hand);
+
+    return countCards(hand >> (getHighestCardIdx(others) + 1));
 }
 
-CGameState::CGameState(const CGameState & rGame)
-    : m_score(rGame.m_score)
+} // namespace
 
-    // The copy will have the same reference to cards left pack, but it will not own it
-    , m_pCardsLeft(rGame.m_pCardsLeft)
-    , m_bOwnsCardsLeft(false)
+bool GameStateData::operator<(const GameStateData & rState) const
 {
-    m_aPlayers[0] = new CPlayer(*rGame.m_aPlayers[0]);
-    m_aPlayers[1] = new CPlayer(*rGame.m_aPlayers[1]);
-    m_aPlayers[2] = new CPlayer(*rGame.m_aPlayers[2]);
+    if(m_iCardsOnTableCount != rState.m_iCardsOnTableCount)
+        return m_iCardsOnTableCount < rState.m_iCardsOnTableCount;
 
-    m_trumpSuit = rGame.m_trumpSuit;
-    m_currentSuit = rGame.m_currentSuit;
-    m_iActivePlayer = rGame.m_iActivePlayer;
-    
-    m_iCardsOnTableCount = rGame.m_iCardsOnTableCount;
-    memcpy(m_aCardsOnTable, rGame.m_aCardsOnTable, 3*sizeof(Card));
+    for(unsigned int i=0; i<m_iCardsOnTableCount; i++)
+    {
+        if(m_aCardsOnTable[i] != rState.m_aCardsOnTable[i])
+            return m_aCardsOnTable[i] < rState.m_aCardsOnTable[i];
+    }
 
-    m_pCache = rGame.m_pCache;
-}
+    for(unsigned int i=0; i<MAX_PLAYERS; i++)
+    {
+        if(m_aHands[i] != rState.m_aHands[i])
+            return m_aHands[i] < rState.m_aHands[i];
+    }
 
-CGameState::~CGameState()
-{
-    delete m_aPlayers[0];
-    delete m_aPlayers[1];
-    delete m_aPlayers[2];
+    if(m_iActivePlayer != rState.m_iActivePlayer)
+        return m_iActivePlayer < rState.m_iActivePlayer;
 
-    releaseCardsLeft();
-}
+    if(m_score < rState.m_score)
+        return true;
+    if(rState.m_score < m_score)
+        return false;
 
-CCardPack CGameState::getCardsLeft()
-{
-    return m_aPlayers[0]->getCards() +
-           m_aPlayers[1]->getCards() +
-           m_aPlayers[2]->getCards();
+    if(m_trumpSuit != rState.m_trumpSuit)
+        return m_trumpSuit < rState.m_trumpSuit;
+
+    return m_currentSuit < rState.m_currentSuit;
 }
 
-void CGameState::setUpCardsLeft()
+void GameStateData::pack(GameStateKey & key) const
 {
-    releaseCardsLeft();
-    m_pCardsLeft = new CCardPack(getCardsLeft()); // TODO: optimize object creation
-    m_bOwnsCardsLeft = true;
+    uint32_t extra = m_iCardsOnTableCount;
+    if(m_iCardsOnTableCount > 0)
+        extra |= getCardIdx(m_aCardsOnTable[0]) << 2;
+    if(m_iCardsOnTableCount > 1)
+        extra |= getCardIdx(m_aCardsOnTable[1]) << 7;
+
+    extra |= static_cast<uint32_t>(m_iActivePlayer) << 12;
+    extra |= getSuitIdx(static_cast<CardSuit>(m_trumpSuit)) << 14;
+    extra |= getSuitIdx(static_cast<CardSuit>(m_currentSuit)) << 17;
+
+    key.m_aWords[0] = uint64_t(m_aHands[0]) | (uint64_t(m_aHands[1]) << 32);
+    key.m_aWords[1] = uint64_t(m_aHands[2]) | (uint64_t(extra) << 32);
 }
 
-void CGameState::releaseCardsLeft()
+void GameStateData::unpack(const GameStateKey & key)
 {
-    if(!m_bOwnsCardsLeft)
-        return;
-
-    delete m_pCardsLeft;
-    m_pCardsLeft = nullptr;
-    m_bOwnsCardsLeft = false;
+    // Suit index back to the suit value
+    auto getSuitByIdx = [](unsigned int idx)
+    {
+        return static_cast<uint8_t>(idx == SUIT_IDX_COUNT - 1 ? static_cast<unsigned int>(CS_UNKNOWN) : idx << 4);
+    };
+
+    uint32_t extra = static_cast<uint32_t>(key.m_aWords[1] >> 32);
+    m_aHands[0] = static_cast<CardMask>(key.m_aWords[0]);
+    m_aHands[1] = static_cast<CardMask>(key.m_aWords[0] >> 32);
+    m_aHands[2] = static_cast<CardMask>(key.m_aWords[1]);
+
+    m_iCardsOnTableCount = extra & 0x03;
+    m_aCardsOnTable[0] = getCardByIdx((extra >> 2) & 0x1f);
+    m_aCardsOnTable[1] = getCardByIdx((extra >> 7) & 0x1f);
+    m_aCardsOnTable[2] = getCardByIdx(0);
+
+    m_iActivePlayer = (extra >> 12) & 0x03;
+    m_trumpSuit = getSuitByIdx((extra >> 14) & 0x07);
+    m_currentSuit = getSuitByIdx((extra >> 17) & 0x07);
+    m_score = CScore();
+
+    // Cards left include cards on the table
+    m_cardsLeft = m_aHands[0] | m_aHands[1] | m_aHands[2];
+    for(unsigned int i = 0; i < m_iCardsOnTableCount; i++)
+        m_cardsLeft |= getCardBit(m_aCardsOnTable[i]);
 }
 
-bool CGameState::operator<(const CGameState & rGame) const
+CGameState::CGameState(const CPlayer & p1, const CPlayer & p2, const CPlayer & p3)
+    : m_state()
 {
-    if(m_iCardsOnTableCount < rGame.m_iCardsOnTableCount)
-        return true;
-    if(rGame.m_iCardsOnTableCount < m_iCardsOnTableCount)
-        return false;
-        
-    for(unsigned int i=0; i<m_iCardsOnTableCount; i++)
+    const CPlayer * aPlayers[MAX_PLAYERS] = {&p1, &p2, &p3};
+    for(unsigned int i=0; i<MAX_PLAYERS; i++)
     {
-        if(m_aCardsOnTable[i] < rGame.m_aCardsOnTable[i])
-            return true;
-        if(rGame.m_aCardsOnTable[i] < m_aCardsOnTable[i])
-            return false;
+        if(aPlayers[i]->getCards().hasUnknownCards())
+            throw "CGameState::CGameState(): Unknown cards are not supported";
+
+        m_state.m_aHands[i] = aPlayers[i]->getCards().getCardsMask();
+        m_aStrategies[i] = aPlayers[i]->getPlayerStrategy();
     }
-    
-    for(unsigned int i=0; i<MAX_PLAYERS; i++)
+
+    // If all strategies refer to the same player, this is a zero sum game of the player
+    // against the coalition of the others
+    m_iTargetPlayer = getStrategyPlayer(m_aStrategies[0]);
+    for(unsigned int i=1; i<MAX_PLAYERS; i++)
     {
-        if(*(m_aPlayers[i]) < *(rGame.m_aPlayers[i]))
-            return true;
-        if(*(rGame.m_aPlayers[i]) < *(m_aPlayers[i]))
-            return false;
+        if(getStrategyPlayer(m_aStrategies[i]) != m_iTargetPlayer)
+            m_iTargetPlayer = MAX_PLAYERS;
     }
 
-    if(m_iActivePlayer < rGame.m_iActivePlayer)
-        return true;
-    if(rGame.m_iActivePlayer < m_iActivePlayer)
-        return false;
+    m_state.m_cardsLeft = m_state.m_aHands[0] | m_state.m_aHands[1] | m_state.m_aHands[2];
 
-    if(m_score < rGame.m_score)
-        return true;
-    if(rGame.m_score < m_score)
-        return false;
-	
-    if(m_trumpSuit < rGame.m_trumpSuit)
-        return true;
-    if(rGame.m_trumpSuit < m_trumpSuit)
-        return false;
-	
-    if(m_currentSuit < rGame.m_currentSuit)
-        return true;
-    if(rGame.m_currentSuit < m_currentSuit)
-        return false;
+    m_state.m_trumpSuit = CS_UNKNOWN;
+    m_state.m_currentSuit = CS_UNKNOWN;
+    m_state.m_iActivePlayer = 0;
+    m_state.m_iCardsOnTableCount = 0;
 
-    return false;
+    m_pCache = nullptr;
+    m_pOrdering = nullptr;
+}
+
+bool CGameState::operator<(const CGameState & rGame) const
+{
+    return m_state < rGame.m_state;
 }
 
 std::ostream& operator<< (std::ostream& out, const CGameState & game)
 {
     out << std::endl;
-    out << "0: " << *game.m_aPlayers[0] << std::endl;
-    out << "1: " << *game.m_aPlayers[1] << std::endl;
-    out << "2: " << *game.m_aPlayers[2] << std::endl;
-    out << "Active player: " << game.m_iActivePlayer << std::endl;
-    out << "Current score: " << game.m_score;
+    out << "0: Player cards: " << CCardPack(game.m_state.m_aHands[0]) << std::endl;
+    out << "1: Player cards: " << CCardPack(game.m_state.m_aHands[1]) << std::endl;
+    out << "2: Player cards: " << CCardPack(game.m_state.m_aHands[2]) << std::endl;
+    out << "Active player: " << static_cast<unsigned int>(game.m_state.m_iActivePlayer) << std::endl;
+    out << "Current score: " << game.m_state.m_score;
     
     return out;
 }
@@ -137,89 +160,421 @@ std::ostream& operator<< (std::ostream& out, const CGameState & game)
 void CGameState::makeTurn(Card card)
 {
     // Update players and table information
-    m_aPlayers[m_iActivePlayer]->removeCard(card);
-    m_aCardsOnTable[m_iCardsOnTableCount++] = card;
-    m_iActivePlayer = (++m_iActivePlayer) % MAX_PLAYERS;
+    m_state.m_aHands[m_state.m_iActivePlayer] &= ~getCardBit(card);
+    m_state.m_aCardsOnTable[m_state.m_iCardsOnTableCount++] = card;
+    m_state.m_iActivePlayer = (m_state.m_iActivePlayer + 1) % MAX_PLAYERS;
     
     // First card on the table defines current trick suit (if not defined explicitely)
-    if(m_iCardsOnTableCount == 1 && m_currentSuit != CS_UNKNOWN)
-        m_currentSuit = getSuit(card);
+    if(m_state.m_iCardsOnTableCount == 1 && m_state.m_currentSuit == CS_UNKNOWN)
+        m_state.m_currentSuit = getSuit(card);
 
     // 3rd card on the table completes the trick
-    if(m_iCardsOnTableCount == 3)
+    if(m_state.m_iCardsOnTableCount == 3)
     {
         //Calculate the winner
-        unsigned int iWinner = calcTrickWinner(m_aCardsOnTable[0],
-                                               m_aCardsOnTable[1],
-                                               m_aCardsOnTable[2],
-                                               m_trumpSuit);
+        unsigned int iWinner = lookupTrickWinner(m_state.m_aCardsOnTable[0],
+                                                 m_state.m_aCardsOnTable[1],
+                                                 m_state.m_aCardsOnTable[2],
+                                                 getTrumpSuit());
 
         // Increase the winner's score
-        iWinner = (m_iActivePlayer + iWinner) % MAX_PLAYERS;
-        m_score.incPlayerScore(iWinner);
+        iWinner = (m_state.m_iActivePlayer + iWinner) % MAX_PLAYERS;
+        m_state.m_score.incPlayerScore(iWinner);
+
+        // Trick cards are out of game now
+        m_state.m_cardsLeft &= ~(getCardBit(m_state.m_aCardsOnTable[0]) |
+                                 getCardBit(m_state.m_aCardsOnTable[1]) |
+                                 getCardBit(m_state.m_aCardsOnTable[2]));
 
         // Prepare for new trick
-        m_iCardsOnTableCount = 0;
-        m_currentSuit = CS_UNKNOWN;
-        m_iActivePlayer = iWinner;
+        m_state.m_iCardsOnTableCount = 0;
+        m_state.m_currentSuit = CS_UNKNOWN;
+        m_state.m_iActivePlayer = static_cast<uint8_t>(iWinner);
     }
 }
 
-void CGameState::setUpNewTrick()
+void CGameState::makeTurn(Card card, TurnUndoInfo & undo)
+{
+    undo.m_state = m_state;
+    makeTurn(card);
+}
+
+void CGameState::unmakeTurn(const TurnUndoInfo & undo)
 {
-    setUpCardsLeft();
-    m_currentSuit = CS_UNKNOWN;
+    m_state = undo.m_state;
 }
 
 CCardPack CGameState::getActivePlayerValidTurns()
 {
     // Get list of turns and filter out equivalent ones
-    CCardPack validTurns = m_aPlayers[m_iActivePlayer]->getListOfValidTurns(m_currentSuit, m_trumpSuit);
-    validTurns.filterOutEquivalentCards(*m_pCardsLeft);
+    CCardPack validTurns = CPlayer::getValidTurns(CCardPack(m_state.m_aHands[m_state.m_iActivePlayer]),
+                                                  getCurrentSuit(), getTrumpSuit());
+    validTurns.filterOutEquivalentCards(getCardsLeft());
 
     return validTurns;
 }
 
-CPath CGameState::playGameRecursive()
+void CGameState::getTargetScoreBounds(int & iLower, int & iUpper) const
 {
-    // Check if this state was already visited
-    if(m_pCache)
+    if(!isZeroSumGame())
+        throw "CGameState::getTargetScoreBounds(): The game has no target player";
+
+    // Tricks left include the trick on the table
+    CardMask allCards = m_state.m_aHands[0] | m_state.m_aHands[1] | m_state.m_aHands[2];
+    int iScore = m_state.m_score.getPlayerScore(m_iTargetPlayer);
+    iLower = iScore;
+    iUpper = iScore + countCards(m_state.m_cardsLeft) / MAX_PLAYERS;
+
+    CardSuit trump = getTrumpSuit();
+    unsigned int aTopTrumps[MAX_PLAYERS] = {0, 0, 0};
+    unsigned int aTrumpsCount[MAX_PLAYERS] = {0, 0, 0};
+    if(trump != CS_UNKNOWN)
+    {
+        // Cards left include the table, so each top trump wins its own trick
+        SuitMask trumps = getSuitMask(m_state.m_cardsLeft, trump);
+        for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        {
+            SuitMask hand = getSuitMask(m_state.m_aHands[i], trump);
+            aTopTrumps[i] = countTopCards(hand, trumps);
+            aTrumpsCount[i] = countCards(hand);
+
+            if(i == m_iTargetPlayer)
+                iLower += aTopTrumps[i];
+            else
+                iUpper -= aTopTrumps[i];
+        }
+    }
+
+    // The player on lead cashes top cards, if he wants to take tricks
+    unsigned int iPlayer = m_state.m_iActivePlayer;
+    bool bWantsTricks = (iPlayer == m_iTargetPlayer) == isMaxStrategy(m_aStrategies[iPlayer]);
+    if(m_state.m_iCardsOnTableCount != 0 || !bWantsTricks)
+        return;
+
+    // Top trumps are played first, other players follow with their trumps. Top cards of
+    // other suits are safe, only when other players have no trumps left
+    unsigned int iTricks = aTopTrumps[iPlayer];
+    unsigned int iOtherTrumps = std::max(aTrumpsCount[(iPlayer + 1) % MAX_PLAYERS],
+                                         aTrumpsCount[(iPlayer + 2) % MAX_PLAYERS]);
+    if(iOtherTrumps <= iTricks)
     {
-        CPath cachedPath = m_pCache->getVisitedState(*this);
-        if(cachedPath.isValid())
-            return cachedPath;
+        for(CardSuit suit : {CS_SPIDES, CS_CLUBS, CS_DIAMONDS, CS_HEARTS})
+        {
+            if(suit != trump)
+                iTricks += countTopCards(getSuitMask(m_state.m_aHands[iPlayer], suit), getSuitMask(allCards, suit));
+        }
     }
 
-    // Cleanup and prepare for the new trick
-    if(m_iCardsOnTableCount == 0)
-        setUpCardsLeft();
+    if(iPlayer == m_iTargetPlayer)
+        iLower = std::max(iLower, iScore + static_cast<int>(iTricks));
+    else
+        iUpper = std::min(iUpper, iScore + static_cast<int>(countCards(allCards) / MAX_PLAYERS - iTricks));
+}
+
+bool CGameState::checkClaim(CScore & score) const
+{
+    unsigned int iPlayer = m_state.m_iActivePlayer;
+    CardMask hand = m_state.m_aHands[iPlayer];
+    if(m_state.m_iCardsOnTableCount != 0 || hand == 0)
+        return false;
+
+    // Every card of the player wins a trick of its suit
+    CardMask others = m_state.m_aHands[(iPlayer + 1) % MAX_PLAYERS] | m_state.m_aHands[(iPlayer + 2) % MAX_PLAYERS];
+    for(CardSuit suit : {CS_SPIDES, CS_CLUBS, CS_DIAMONDS, CS_HEARTS})
+    {
+        SuitMask handSuit = getSuitMask(hand, suit);
+        SuitMask othersSuit = getSuitMask(others, suit);
+        if(handSuit != 0 && othersSuit != 0 && getLowestCardIdx(handSuit) < getHighestCardIdx(othersSuit))
+            return false;
+    }
 
+    // Other players' trumps shall be drawn first, the player does it only if he wants tricks.
+    // The side, that minimizes the target player's score, takes tricks in zero sum games
+    CardSuit trump = getTrumpSuit();
+    if(trump != CS_UNKNOWN && (others & getSuitCardsMask(trump)) != 0)
+    {
+        CardMask trumps = getSuitCardsMask(trump);
+        unsigned int iTrumps = countCards(hand & trumps);
+        if(countCards(m_state.m_aHands[(iPlayer + 1) % MAX_PLAYERS] & trumps) > iTrumps ||
+           countCards(m_state.m_aHands[(iPlayer + 2) % MAX_PLAYERS] & trumps) > iTrumps)
+            return false;
+
+        PlayerStrategy strategy = m_aStrategies[iPlayer];
+        bool bWantsTricks = getStrategyPlayer(strategy) == iPlayer ? isMaxStrategy(strategy) :
+                                                                     isZeroSumGame() && !isMaxStrategy(strategy);
+        if(!bWantsTricks)
+            return false;
+    }
+
+    score = m_state.m_score;
+    score.setPlayerScore(iPlayer, static_cast<unsigned char>(score.getPlayerScore(iPlayer) + countCards(hand)));
+    return true;
+}
+
+CScore CGameState::searchOptimalTurn(Card & bestTurn)
+{
+    if(m_iTargetPlayer >= MAX_PLAYERS)
+        return searchMaxN(bestTurn);
+
+    // Null window searches are useful only when bounds are stored between searches
+    int iValue;
+    if(m_pCache)
+        iValue = searchMTDF();
+    else
+        iValue = searchAlphaBeta(bestTurn, -1, HAND_SIZE + 1).getPlayerScore(m_iTargetPlayer);
+
+    return searchFirstOptimalTurn(bestTurn, iValue);
+}
+
+CScore CGameState::searchFirstOptimalTurn(Card & bestTurn, int iValue)
+{
     CCardPack possibleTurns = getActivePlayerValidTurns();
 
     // end of recursion, if no turns can be done
+    bestTurn = UNKNOWN_CARD;
     if(possibleTurns.getCardsCount() == 0)
+        return m_state.m_score;
+
+    // Turns go in cards order, and the first one, that gets the value, is taken. Other turns
+    // only need to be proven worse, this is usually done by bounds from the cache
+    bool bMaximize = isMaxStrategy(m_aStrategies[m_state.m_iActivePlayer]);
+    CScore subScore;
+    for(CardMask turns = possibleTurns.getCardsMask(); turns != 0; turns &= turns - 1)
+    {
+        Card card = getCardByIdx(getLowestCardIdx(turns));
+
+        TurnUndoInfo undo;
+        Card subTurn;
+        makeTurn(card, undo);
+        if(bMaximize)
+            subScore = searchAlphaBeta(subTurn, iValue - 1, iValue);
+        else
+            subScore = searchAlphaBeta(subTurn, iValue, iValue + 1);
+        unmakeTurn(undo);
+
+        int iSubValue = subScore.getPlayerScore(m_iTargetPlayer);
+        if(bMaximize ? iSubValue >= iValue : iSubValue <= iValue)
+        {
+            bestTurn = card;
+            break;
+        }
+    }
+
+    return subScore;
+}
+
+int CGameState::searchMTDF()
+{
+    // The target player keeps the tricks already taken, and takes tricks with his top cards
+    int iLower;
+    int iUpper;
+    getTargetScoreBounds(iLower, iUpper);
+
+    // Bounds from the cache narrow the search, and the lower one is the first guess
+    CScore score;
+    CScore upper;
+    Card bestTurn;
+    if(m_pCache->getVisitedState(*this, score, upper, bestTurn))
     {
-        return CPath(m_score);
+        iLower = std::max(iLower, static_cast<int>(score.getPlayerScore(m_iTargetPlayer)));
+        iUpper = std::min(iUpper, static_cast<int>(upper.getPlayerScore(m_iTargetPlayer)));
     }
 
-    // Process all valid turns and select the most optimal one
-    CPath path(m_aPlayers[m_iActivePlayer]->getPlayerStrategy());
-    for(unsigned int i=0; i<possibleTurns.getCardsCount(); i++)
+    int iGuess = iLower;
+
+    // Each search tells if the value is below or above the guess, and narrows the bounds
+    while(iLower < iUpper)
     {
-        Card card = possibleTurns.getCard(i);
+        int iBeta = (iGuess == iLower) ? iGuess + 1 : iGuess;
+        score = searchAlphaBeta(bestTurn, iBeta - 1, iBeta);
+        iGuess = score.getPlayerScore(m_iTargetPlayer);
+        if(iGuess < iBeta)
+            iUpper = iGuess;
+        else
+            iLower = iGuess;
+    }
 
-        // Make a copy of current state, and play the turn recursively
-        CGameState newState(*this);
-        newState.makeTurn(card);
-        CPath subPath = newState.playGameRecursive();
+    return iLower;
+}
 
-        // Search for the best subpath
-        path.addSubPath(card, subPath);
+CScore CGameState::searchMaxN(Card & bestTurn)
+{
+    // Check if this state was already visited
+    CScore score;
+    if(m_pCache && m_pCache->getVisitedState(*this, score, bestTurn))
+        return score;
+
+    CCardPack possibleTurns = getActivePlayerValidTurns();
+
+    // end of recursion, if no turns can be done
+    bestTurn = UNKNOWN_CARD;
+    if(possibleTurns.getCardsCount() == 0)
+        return m_state.m_score;
+
+    // Process all valid turns and select the most optimal one. The first turn is optimal
+    // until a better one is found
+    PlayerStrategy strategy = m_aStrategies[m_state.m_iActivePlayer];
+    for(CardMask turns = possibleTurns.getCardsMask(); turns != 0; turns &= turns - 1)
+    {
+        Card card = getCardByIdx(getLowestCardIdx(turns));
+
+        // Play the turn recursively, unless the rest of tricks is claimed, and then take it back
+        TurnUndoInfo undo;
+        Card subTurn;
+        CScore subScore;
+        makeTurn(card, undo);
+        if(!checkClaim(subScore))
+            subScore = searchMaxN(subTurn);
+        unmakeTurn(undo);
+
+        if(bestTurn == UNKNOWN_CARD || score.isScoreHeigher(subScore, strategy))
+        {
+            score = subScore;
+            bestTurn = card;
+        }
     }
 
     // Store found solution in the visited states cache
     if(m_pCache)
-        m_pCache->addVisitedState(*this, path);
+        m_pCache->addVisitedState(*this, score, bestTurn);
+
+    return score;
+}
+
+CScore CGameState::searchAlphaBeta(Card & bestTurn, int iAlpha, int iBeta)
+{
+    // Bounds from the cache are used if they are enough for the window, otherwise the
+    // cached turn is searched first
+    CScore score;
+    CScore upper;
+    Card hashTurn = UNKNOWN_CARD;
+    if(m_pCache && m_pCache->getVisitedState(*this, score, upper, hashTurn))
+    {
+        bestTurn = hashTurn;
+        if(score == upper || score.getPlayerScore(m_iTargetPlayer) >= iBeta)
+            return score;
+        if(upper.getPlayerScore(m_iTargetPlayer) <= iAlpha)
+            return upper;
+    }
+
+    // Lopsided endings are settled by top cards without search. Claims and bounds are
+    // checked at the start of a trick only, as cashing top cards needs the lead
+    bestTurn = UNKNOWN_CARD;
+    if(m_state.m_iCardsOnTableCount == 0)
+    {
+        if(checkClaim(score))
+            return score;
+
+        int iLower;
+        int iUpper;
+        getTargetScoreBounds(iLower, iUpper);
+
+        score = m_state.m_score;
+        if(iLower >= iBeta || iLower == iUpper)
+        {
+            score.setPlayerScore(m_iTargetPlayer, static_cast<unsigned char>(iLower));
+            return score;
+        }
+        if(iUpper <= iAlpha)
+        {
+            score.setPlayerScore(m_iTargetPlayer, static_cast<unsigned char>(iUpper));
+            return score;
+        }
+    }
+
+    CCardPack possibleTurns = getActivePlayerValidTurns();
+
+    // end of recursion, if no turns can be done
+    if(possibleTurns.getCardsCount() == 0)
+        return m_state.m_score;
+
+    // Promising turns go first (see CMoveOrdering), or just in cards order
+    Card aTurns[MAX_CARDS];
+    unsigned int iTurnsCount = 0;
+    if(m_pOrdering && possibleTurns.getCardsCount() > 1)
+        iTurnsCount = m_pOrdering->orderTurns(*this, possibleTurns.getCardsMask(), hashTurn, aTurns);
+    else
+    {
+        for(CardMask turns = possibleTurns.getCardsMask(); turns != 0; turns &= turns - 1)
+            aTurns[iTurnsCount++] = getCardByIdx(getLowestCardIdx(turns));
+    }
+
+    // The first turn is optimal until a better one is found. Search stops as soon as the
+    // score gets out of the window, as the opponents will not let the game go this way
+    const int iAlphaOrig = iAlpha;
+    const int iBetaOrig = iBeta;
+    bool bMaximize = isMaxStrategy(m_aStrategies[m_state.m_iActivePlayer]);
+    int iValue = 0;
+    for(unsigned int i = 0; i < iTurnsCount; i++)
+    {
+        Card card = aTurns[i];
+
+        // Play the turn recursively, and then take it back
+        TurnUndoInfo undo;
+        Card subTurn;
+        makeTurn(card, undo);
+        CScore subScore = searchAlphaBeta(subTurn, iAlpha, iBeta);
+        unmakeTurn(undo);
+
+        int iSubValue = subScore.getPlayerScore(m_iTargetPlayer);
+        if(bestTurn == UNKNOWN_CARD || (bMaximize ? iSubValue > iValue : iSubValue < iValue))
+        {
+            score = subScore;
+            bestTurn = card;
+            iValue = iSubValue;
+        }
+
+        if(bMaximize && iValue > iAlpha)
+            iAlpha = iValue;
+        if(!bMaximize && iValue < iBeta)
+            iBeta = iValue;
+        if(iAlpha >= iBeta)
+        {
+            if(m_pOrdering)
+                m_pOrdering->addCutoff(*this, bestTurn);
+            break;
+        }
+    }
+
+    // Scores out of the window are just bounds
+    if(m_pCache)
+    {
+        if(iValue <= iAlphaOrig)
+            m_pCache->addVisitedState(*this, score, bestTurn, SB_UPPER);
+        else if(iValue >= iBetaOrig)
+            m_pCache->addVisitedState(*this, score, bestTurn, SB_LOWER);
+        else
+            m_pCache->addVisitedState(*this, score, bestTurn, SB_EXACT);
+    }
+
+    return score;
+}
+
+CPath CGameState::playGameRecursive()
+{
+    Card aTurns[MAX_CARDS];
+    TurnUndoInfo aUndo[MAX_CARDS];
+    size_t iCount = 0;
+
+    // Search the optimal turn of each state of the optimal path
+    Card turn;
+    searchOptimalTurn(turn);
+    while(turn != UNKNOWN_CARD)
+    {
+        aTurns[iCount] = turn;
+        makeTurn(turn, aUndo[iCount]);
+        iCount++;
+
+        searchOptimalTurn(turn);
+    }
+
+    // The score of the path itself. Players, that the strategies do not refer to, may get
+    // different scores on paths with the same value (see searchMTDF())
+    CScore score = m_state.m_score;
+
+    // Get back to the initial state
+    for(size_t i = iCount; i > 0; i--)
+        unmakeTurn(aUndo[i - 1]);
 
-    return path;
+    return CPath(score, aTurns, iCount);
 }
@@ -8,6 +8,8 @@
 
 #include <vector>
 #include <iostream>
+#include <cstdint>
+#include <type_traits>
 
 #include "Player.h"
 #include "Score.h"
@@ -15,6 +17,132 @@
 #include "Path.h"
 
 class CVisitedStateCache;
+class CMoveOrdering;
+
+/**
+ * @brief Game state key
+ *
+ * This is a 128 bit encoding of the game state (see GameStateData::pack()), that is used as
+ * a key in the visited states cache.
+ */
+struct GameStateKey
+{
+    /// Key data
+    uint64_t m_aWords[2];
+
+    /// Equivalence operator
+    inline bool operator==(const GameStateKey & rKey) const
+    {
+        return m_aWords[0] == rKey.m_aWords[0] && m_aWords[1] == rKey.m_aWords[1];
+    }
+};
+
+/**
+ * @brief Packed game state
+ *
+ * This structure holds all the data of the game state, that changes during the game. It is
+ * trivially copyable and small, so that it can be copied with memcpy(), and used as a key
+ * of the visited states cache.
+ */
+struct GameStateData
+{
+    /// Players' cards
+    CardMask m_aHands[MAX_PLAYERS];
+    /// Cards in game: players' cards at the current trick start (including cards on the table)
+    CardMask m_cardsLeft;
+    /// Current game score
+    CScore m_score;
+    /// List of cards present on the table (current trick)
+    Card m_aCardsOnTable[MAX_PLAYERS];
+    /// Number of cards on the table (current trick)
+    uint8_t m_iCardsOnTableCount;
+    /// Player, that will do next turn
+    uint8_t m_iActivePlayer;
+    /// Trump suit in game (CardSuit value)
+    uint8_t m_trumpSuit;
+    /// Current suit (CardSuit value, undefined if there is no cards in trick yet)
+    uint8_t m_currentSuit;
+
+    /**
+     * @brief Equivalence operator
+     *
+     * @note Cards on the table are compared only up to the cards count. Cards left are not compared,
+     *       as they are defined by players' cards and cards on the table
+     *
+     * @param rState - state to compare with
+     *
+     * @return \a true if states are equal
+     */
+    inline bool operator==(const GameStateData & rState) const
+    {
+        if(m_aHands[0] != rState.m_aHands[0] ||
+           m_aHands[1] != rState.m_aHands[1] ||
+           m_aHands[2] != rState.m_aHands[2] ||
+           !(m_score == rState.m_score) ||
+           m_iCardsOnTableCount != rState.m_iCardsOnTableCount ||
+           m_iActivePlayer != rState.m_iActivePlayer ||
+           m_trumpSuit != rState.m_trumpSuit ||
+           m_currentSuit != rState.m_currentSuit)
+            return false;
+
+        for(unsigned int i = 0; i < m_iCardsOnTableCount; i++)
+            if(m_aCardsOnTable[i] != rState.m_aCardsOnTable[i])
+                return false;
+
+        return true;
+    }
+
+    /**
+     * @brief Less-than operator
+     *
+     * This operator compares states field by field, so that states can be stored in ordered
+     * containers.
+     *
+     * @param rState - state to compare with
+     *
+     * @return \a true if this state is less than specified
+     */
+    bool operator<(const GameStateData & rState) const;
+
+    /**
+     * @brief Pack the state into the key
+     *
+     * The key holds players' cards in 96 bits, and the rest of the state in the remaining
+     * 32 bits: cards on the table (count and indexes), active player, trump and current suit.
+     *
+     * The score is not packed: states that differ only by the score of the played tricks
+     * share the key, and the cache stores the score of tricks that are still to come.
+     *
+     * @note At most 2 cards can be on the table (3rd card completes the trick)
+     *
+     * @param key   - resulting key
+     */
+    void pack(GameStateKey & key) const;
+
+    /**
+     * @brief Unpack the state from the key
+     *
+     * @note The score is set to zero, as it is not packed
+     *
+     * @param key   - key made with pack()
+     */
+    void unpack(const GameStateKey & key);
+};
+
+static_assert(std::is_trivially_copyable<GameStateData>::value, "Game state data shall be trivially copyable");
+static_assert(sizeof(GameStateData) <= 32, "Game state data shall be compact");
+
+/**
+ * @brief Turn undo information
+ *
+ * This structure holds the data needed to take the turn back (see CGameState::makeTurn()
+ * and CGameState::unmakeTurn())
+ */
+struct TurnUndoInfo
+{
+    /// Game state before the turn
+    GameStateData m_state;
+};
 
 /**
  * @brief The Game State
@@ -22,6 +150,10 @@ class CVisitedStateCache;
  * This class represents the game state. This is a data holder class that contains information
  * about player's and their cards, current score, etc. Additionally it implements game logic,
  * as well as calculating optimal turn.
+ *
+ * All the data, that changes during the game, is stored in a packed GameStateData structure,
+ * while this class adds the data constant for the game (players' strategies) and the
+ * search related data.
  */
 class CGameState
 {
@@ -31,8 +163,10 @@ public:
      *
      * This constructor allows creating new game state with specified players.
      *
+     * @throw "const char *" exception if players have unknown cards
+     *
      * It will initialize internal data as follows:
-     * - Players will be initialized as specified
+     * - Players' cards and strategies will be initialized as specified
      * - trump suit is unknown
      * - active player is player 0
      * - cards on table (cards in current trick) - empty
@@ -52,14 +186,14 @@ public:
      *
      * @param rGame - game to copy
      */
-    CGameState(const CGameState & rGame);
+    CGameState(const CGameState & rGame) = default;
     
     /**
      * @brief The game destructor
      *
-     * This destructor will release internal data, such as allocated player objects
+     * This destructor does nothing, as the game state does not own any data
      */
-    ~CGameState();
+    ~CGameState() = default;
 
 ///@name Operators
 //@{
@@ -72,9 +206,7 @@ public:
      *
      * This operator is intended for comparing two game states.
      *
-     * @note This operator is needed to handle the game states in visited states cache.
-     * Actually it is not a good idea and most time is wasted in this operator, but it
-     * allows to decrease number of processing states significantly.
+     * @note Only packed state data is compared (see GameStateData)
      *
      * @param rGame - game state to compare with current game state
      *
@@ -100,7 +232,7 @@ public:
      */
     inline void setScore(const CScore & score)
     {
-        m_score = score;
+        m_state.m_score = score;
     }
 
     /**
@@ -116,6 +248,19 @@ public:
         m_pCache = pCache;
     }
 
+    /**
+     * @brief Set move ordering to use
+     *
+     * This method sets move ordering for alpha-beta searches, or resets to nullptr, so that
+     * turns are searched in cards order. Game state object does not own the ordering.
+     *
+     * @param pOrdering - pointer to a move ordering or nullptr if not used
+     */
+    inline void setMoveOrdering(CMoveOrdering * pOrdering)
+    {
+        m_pOrdering = pOrdering;
+    }
+
     /**
      * @brief Set active player
      *
@@ -131,7 +276,7 @@ public:
         if(p >= MAX_PLAYERS)
             throw "CGameState::setActivePlayer(): player index is out of bounds";
             
-        m_iActivePlayer = p;
+        m_state.m_iActivePlayer = static_cast<uint8_t>(p);
     }
 
     /**
@@ -141,9 +286,31 @@ public:
      */
     inline unsigned int getActivePlayer() const
     {
-        return m_iActivePlayer;
+        return m_state.m_iActivePlayer;
     }
     
+    /**
+     * @brief Get active player's strategy
+     *
+     * @return the strategy of the player, that will do next turn
+     */
+    inline PlayerStrategy getActivePlayerStrategy() const
+    {
+        return m_aStrategies[m_state.m_iActivePlayer];
+    }
+
+    /**
+     * @brief Get player's strategy
+     *
+     * @param p - the player index
+     *
+     * @return the strategy of the player
+     */
+    inline PlayerStrategy getPlayerStrategy(unsigned int p) const
+    {
+        return m_aStrategies[p];
+    }
+
     /**
      * @brief Get trum suit
      *
@@ -153,7 +320,7 @@ public:
      */
     inline CardSuit getTrumpSuit() const
     {
-        return m_trumpSuit;
+        return static_cast<CardSuit>(m_state.m_trumpSuit);
     }
 
     /**
@@ -165,7 +332,7 @@ public:
      */
     inline void setTrumpSuit(CardSuit suit)
     {
-        m_trumpSuit = suit;
+        m_state.m_trumpSuit = static_cast<uint8_t>(suit);
     }
 
     /**
@@ -178,7 +345,7 @@ public:
      */
     inline CardSuit getCurrentSuit() const
     {
-        return m_currentSuit;
+        return static_cast<CardSuit>(m_state.m_currentSuit);
     }
 
     /**
@@ -191,17 +358,31 @@ public:
      */
     inline void getCurrentSuit(CardSuit suit)
     {
-        m_currentSuit = suit;
+        m_state.m_currentSuit = static_cast<uint8_t>(suit);
+    }
+
+    /**
+     * @brief Retrieve packed state data
+     *
+     * @return the state data
+     */
+    inline const GameStateData & getStateData() const
+    {
+        return m_state;
     }
 
     /**
      * @brief Retrieve the list of all cards in game.
      *
-     * This method creates a list of cards in the game as a sum of players' cards
+     * Cards in the game are players' cards at the start of the current trick, so cards
+     * on the table are included. The list is maintained incrementally by makeTurn().
      *
      * @return card pack of card, that present in game,
      */
-    CCardPack getCardsLeft();
+    inline CCardPack getCardsLeft() const
+    {
+        return CCardPack(m_state.m_cardsLeft);
+    }
 //@}
 
 ///@name Turns related
@@ -222,6 +403,7 @@ public:
      * - If this is last card in trick
      *   - Calculate the trick winner
      *   - increase score of winner player
+     *   - remove trick cards from cards left
      *   - Prepare for new trick:
      *     - Clear the list of cards on the table
      *     - Reset current suit
@@ -233,79 +415,206 @@ public:
      */
     void makeTurn(Card card);
 
+    /**
+     * @brief Make the turn, that can be taken back
+     *
+     * This method is the same as makeTurn(Card), but also stores the information needed
+     * to take the turn back with unmakeTurn()
+     *
+     * @param card  - card to play
+     * @param undo  - turn undo information
+     */
+    void makeTurn(Card card, TurnUndoInfo & undo);
+
+    /**
+     * @brief Take the turn back
+     *
+     * This method restores the state as it was before makeTurn(Card, TurnUndoInfo &) call
+     *
+     * @param undo  - turn undo information
+     */
+    void unmakeTurn(const TurnUndoInfo & undo);
+
+    /**
+     * @brief Search for the optimal game path
+     *
+     * This method searches the optimal score and the optimal turn of the current state
+     * (see searchOptimalTurn()), then plays the optimal turn, and repeats until the end of the
+     * game, so that the optimal path is made. With the visited states cache the states of the
+     * optimal path are usually found in the cache, otherwise they are searched once more.
+     * Turns are made and taken back on this state object, so that the state is the same when
+     * the method returns.
+     *
+     * @return the optimal path
+     */
     CPath playGameRecursive();
 
-protected:
     /**
-     * @brief Prepare for the new trick
+     * @brief Search for the optimal turn
      *
-     * This is a helper method that performs preparation for the new trick round when
-     * working in recursive mode:
-     * - Re-calculate cards left list (need to do this before trick begins,
-     *   and this list remains valid until the end of the trick)
-     * - Reset current suit
-     * .
+     * This method recursively traverses all turns from the current state and selects the
+     * optimal one according to players' strategies. Turns are made and taken back on this
+     * state object, so that the state is the same when the method returns.
+     *
+     * Usually all strategies refer to the same player (e.g. the declarer maximizes his tricks,
+     * and both defenders minimize them), so the game is a zero sum game of the player
+     * against the coalition of the others, and it is searched with alpha-beta (see
+     * searchAlphaBeta()), or with null window searches if the visited states cache is set
+     * (see searchMTDF()). Otherwise each player gets his own goal, and all turns
+     * are searched (see searchMaxN()).
+     *
+     * Visited states cache (if set) holds optimal scores and turns of the searched states.
+     * Move ordering (if set) makes alpha-beta searches faster, but the optimal turn is still
+     * the first one in cards order, that gets the optimal score (see searchFirstOptimalTurn()).
+     *
+     * @note In zero sum games only the score of the player, that the strategies refer to,
+     *       is optimal. Scores of the other players are of some path with the same value.
+     *
+     * @param bestTurn  - the optimal turn, or UNKNOWN_CARD if no turns can be done
+     *
+     * @return the optimal score at the end of the game
      */
-    void setUpNewTrick();
+    CScore searchOptimalTurn(Card & bestTurn);
 
     /**
-     * @brief Prepare a list of valid turns
+     * @brief Check if the game is a zero sum game
      *
-     * When working in a recursive traversing mode this method is responsible for
-     * calculating the list of valid turns for the active player. This method also filters
-     * out equial turns in order to optimize processing.
+     * @return \a true if all players' strategies refer to the same player
      */
-    CCardPack getActivePlayerValidTurns();
-//@}
-    
-///@name Cards Left related functions
-//@{
-protected:
+    inline bool isZeroSumGame() const
+    {
+        return m_iTargetPlayer < MAX_PLAYERS;
+    }
+
     /**
-     * @brief Set up a new Cards Left object for a trick
+     * @brief Retrieve the target player of the zero sum game
      *
-     * This is a helper method to create cards left object. It is supposed there
-     * will be just one cards left object for all states related to the trick. The
-     * root state of the trick will own cards left object, while all others will just
-     * have a pointer.
+     * @return the player, that all players' strategies refer to, or MAX_PLAYERS if players
+     *         have different goals
      */
-    void setUpCardsLeft();
+    inline unsigned int getTargetPlayer() const
+    {
+        return m_iTargetPlayer;
+    }
 
     /**
-     * @brief Release cards left object
+     * @brief Estimate bounds of the target player's score without search
+     *
+     * Bounds are based on top cards, that win tricks whatever other players do:
+     * - Top trumps of a player win tricks, whenever they are played
+     * - At the start of a trick the player on lead, who wants to take tricks, cashes his top
+     *   trumps, and then his top cards of other suits, if other players have no trumps left
+     * .
+     * Tricks of the target player make the lower bound, tricks of other players reduce
+     * the upper bound.
+     *
+     * @throw "const char *" if the game is not a zero sum game (see isZeroSumGame())
      *
-     * This is a helper method to release cards left object (if owned) and
-     * reset the pointer to a default state
+     * @param iLower    - the score, that the target player gets at least
+     * @param iUpper    - the score, that the target player gets at most
      */
-    void releaseCardsLeft();
-//@}
+    void getTargetScoreBounds(int & iLower, int & iUpper) const;
+
+    /**
+     * @brief Check if the player on lead takes all the tricks left
+     *
+     * The player claims the rest of the tricks at the start of a trick, if all his cards
+     * are higher than other players' cards of the same suits, and:
+     * - Other players have no trumps, so every card he leads wins the trick
+     * - Or he has at least as many trumps as each other player, and wants to take tricks,
+     *   so he draws trumps first
+     * .
+     * Scores of all players are exact, so claims are valid for max-n searches as well.
+     *
+     * @param score - the score at the end of the game, if the tricks are claimed
+     *
+     * @return \a true if the player on lead takes all the tricks left
+     */
+    bool checkClaim(CScore & score) const;
 
 protected:
-    /// List of players in game
-    CPlayer * m_aPlayers[MAX_PLAYERS];
-    /// Player, that will do next turn
-    unsigned int m_iActivePlayer;
+    /**
+     * @brief Search for the optimal turn with max-n algorithm
+     *
+     * All turns are searched, and each player selects the turn, that is the best according
+     * to his strategy.
+     *
+     * @param bestTurn  - the optimal turn, or UNKNOWN_CARD if no turns can be done
+     *
+     * @return the optimal score at the end of the game
+     */
+    CScore searchMaxN(Card & bestTurn);
 
-    /// Trump suit in game
-    CardSuit m_trumpSuit;
-    /// Current suit (undefined if there is no cards in trick yet)
-    CardSuit m_currentSuit;
-    /// List of cards present on the table (current trick)
-    Card m_aCardsOnTable[MAX_PLAYERS];
-    /// Number of cards on the table (current trick)
-    unsigned int m_iCardsOnTableCount;
+    /**
+     * @brief Search for the optimal turn with alpha-beta algorithm
+     *
+     * This search is for zero sum games only. The value of the game is the score of the target
+     * player (see m_iTargetPlayer), players with max strategies maximize it, the others minimize.
+     * Once a turn gives a value, that is out of the (iAlpha, iBeta) window, other turns are
+     * not searched.
+     *
+     * The result is exact if its value is inside the window, otherwise it is a bound: the
+     * exact value is not greater than a value below the window (iAlpha or less), and not less
+     * than a value above the window (iBeta or more). Bounds are cached as well, and used
+     * when they are enough to get the result out of the window.
+     *
+     * @param bestTurn  - the optimal turn, or UNKNOWN_CARD if no turns can be done
+     * @param iAlpha    - the value, that the maximizing side already can get
+     * @param iBeta     - the value, that the minimizing side already can get
+     *
+     * @return the optimal score at the end of the game, if its value is inside the window
+     */
+    CScore searchAlphaBeta(Card & bestTurn, int iAlpha, int iBeta);
 
-    /// Current game score
-    CScore m_score;
+    /**
+     * @brief Search for the optimal score with MTD(f) algorithm
+     *
+     * This search is for zero sum games with the visited states cache. The value of the game
+     * is found with a series of null window alpha-beta searches, each of them answers whether
+     * the value is below or above the guess. Values are small (number of tricks), so
+     * a few searches are needed, and null window searches are much cheaper than a full
+     * window one. Bounds, that are stored in the cache, are reused by the next searches.
+     *
+     * @return the optimal score of the target player at the end of the game
+     */
+    int searchMTDF();
 
-    /// List of cards currently present in game
-    CCardPack * m_pCardsLeft;
-    /// Flag indicates that this current object owns m_pCardsLeft
-    /// (otherwise it is just a reference to other's state card pack)
-    bool m_bOwnsCardsLeft;
+    /**
+     * @brief Search for the first turn, that gets the optimal score
+     *
+     * Zero sum game searches find the optimal score, but the turn depends on the turns order
+     * and the cache contents. This method searches turns in cards order, and selects the first
+     * one, that gets the optimal score, so that the optimal path is the same as of max-n search.
+     *
+     * @param bestTurn  - the optimal turn, or UNKNOWN_CARD if no turns can be done
+     * @param iValue    - the optimal score of the target player
+     *
+     * @return the optimal score at the end of the game
+     */
+    CScore searchFirstOptimalTurn(Card & bestTurn, int iValue);
+
+    /**
+     * @brief Prepare a list of valid turns
+     *
+     * When working in a recursive traversing mode this method is responsible for
+     * calculating the list of valid turns for the active player. This method also filters
+     * out equial turns in order to optimize processing.
+     */
+    CCardPack getActivePlayerValidTurns();
+//@}
+    
+protected:
+    /// Packed game state
+    GameStateData m_state;
+    /// Players' strategies
+    PlayerStrategy m_aStrategies[MAX_PLAYERS];
+    /// Player, whose tricks all strategies refer to, or MAX_PLAYERS if players have different goals
+    unsigned int m_iTargetPlayer;
 
     /// Visited states cache or nullptr if not used. Game state object does not own the cache.
     CVisitedStateCache * m_pCache;
+    /// Move ordering or nullptr if not used. Game state object does not own the ordering.
+    CMoveOrdering * m_pOrdering;
 };
 
 #endif //GAME_STATE_H
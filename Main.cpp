@@ -5,6 +5,7 @@
 #include "CardDefs.h"
 #include "GameState.h"
 #include "Player.h"
+#include "MoveOrdering.h"
 #include "Path.h"
 #include "VisitedStateCache.h"
 
@@ -27,12 +28,27 @@ void playPredefinedGame(CGameState & game, const char * solution) //non-const ga
     }
 }
 
-void searchSolution(CGameState & game)
+void searchSolution(CGameState & game, const char * cacheFile)
 {
     clock_t tStart = clock();
     CVisitedStateCache cache;
+    if(cacheFile)
+    {
+        try
+        {
+            cache.attachFile(cacheFile);
+        }
+        catch(const char * error)
+        {
+            std::cout << "Cache file is not used: " << error << std::endl;
+        }
+    }
+
+    CMoveOrdering ordering;
     game.setVisitedStatesCache(&cache);
+    game.setMoveOrdering(&ordering);
     CPath path = game.playGameRecursive();    
+    game.setMoveOrdering(nullptr);
     game.setVisitedStatesCache(nullptr);
     clock_t tStop = clock();
 
@@ -42,10 +58,26 @@ void searchSolution(CGameState & game)
 
     std::cout << "Cache size: " << cache.getCacheSize() << std::endl;
     std::cout << "Cache hits: " << cache.getHitsCount() << std::endl;
+
+    std::cout << "Cache partitions (tricks left, cards on table: hits / misses / stores / size):" << std::endl;
+    for(unsigned int i = 0; i < CVisitedStateCache::PARTITIONS_COUNT; i++)
+    {
+        const CachePartitionStats & stats = cache.getPartitionStats(i);
+        if(stats.m_iStores == 0)
+            continue;
+
+        std::cout << "  " << i / MAX_PLAYERS + 1 << ", " << i % MAX_PLAYERS << ": " << stats.m_iHits << " / " <<
+                     stats.m_iMisses << " / " << stats.m_iStores << " / " << stats.m_iSize << std::endl;
+    }
+
+    if(cacheFile)
+        cache.saveToFile(cacheFile);
 }
 
-int main()
+int main(int argc, char * argv[])
 {
+    // Optional visited states cache file, that is attached at start, and updated at the end
+    const char * cacheFile = (argc > 1) ? argv[1] : nullptr;
 
     // A famous "`Kovalevska's miser" game
     CGameState game(CPlayer("J^ Q^   7+ 9+   1$ J$ Q$ K$   7@ J@", PS_P2MAX),
@@ -56,12 +88,12 @@ int main()
 
 #if 1
     std::cout << "Searching a solution for Kovalevska's miser..." << std::endl;
-    searchSolution(game);
+    searchSolution(game, cacheFile);
 #else
 
     //const char * solution = "K$ 9$ A$ 1@ J@ 9@ Q$ 8$ A^ J$ 7$ K^ 1$ 1^ Q+ Q^ 9^ J+ J^ 8^ 1+ 7+ 8+ A@ 8@ K@ 7@ Q@ 9+ 7^";
     playPredefinedGame(game, "K$ 9$ A$ 1@ J@ 9@ Q$ 8$ A^ J$ 7$ K^");
-    searchSolution(game);
+    searchSolution(game, cacheFile);
 #endif
     return 0;
 }
@@ -0,0 +1,168 @@
+#include "MoveOrdering.h"
+#include "GameState.h"
+
+namespace
+{
+
+/// History counter, that makes the whole table to be halved (see CMoveOrdering::addCutoff())
+const uint32_t HISTORY_LIMIT = 1u << 20;
+
+/**
+ * @brief Count cards in all players' hands
+ *
+ * @param data  - the state
+ *
+ * @return number of cards
+ */
+inline unsigned int countHandsCards(const GameStateData & data)
+{
+    return countCards(data.m_aHands[0] | data.m_aHands[1] | data.m_aHands[2]);
+}
+
+} // namespace
+
+CMoveOrdering::CMoveOrdering()
+{
+    clear();
+}
+
+void CMoveOrdering::clear()
+{
+    for(unsigned int i = 0; i <= MAX_CARDS; i++)
+        for(unsigned int j = 0; j < KILLERS_COUNT; j++)
+            m_aKillers[i][j] = UNKNOWN_CARD;
+
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        for(unsigned int j = 0; j < MAX_CARDS; j++)
+            m_aHistory[i][j] = 0;
+}
+
+unsigned int CMoveOrdering::orderTurns(const CGameState & state, CardMask turns, Card hashTurn, Card * pTurns) const
+{
+    const GameStateData & data = state.getStateData();
+    const Card * pKillers = m_aKillers[countHandsCards(data)];
+    const uint32_t * pHistory = m_aHistory[data.m_iActivePlayer];
+
+    // Sort keys: hash turn, then the heuristic score, killers, and the history counter.
+    // Killers come from other tricks, so they only break ties of the heuristic
+    static_assert(uint64_t(HEURISTIC_SCORE_LIMIT) * (KILLERS_COUNT + 1) * HISTORY_LIMIT < ~0u,
+                  "Heuristic score shall fit the sort key");
+    uint32_t aKeys[MAX_CARDS];
+    unsigned int iCount = 0;
+    for(; turns != 0; turns &= turns - 1)
+    {
+        unsigned int idx = getLowestCardIdx(turns);
+        Card card = getCardByIdx(idx);
+
+        uint32_t key = ~0u;
+        if(card != hashTurn)
+        {
+            unsigned int iKillerBonus = 0;
+            for(unsigned int i = 0; i < KILLERS_COUNT; i++)
+                if(card == pKillers[i])
+                    iKillerBonus = KILLERS_COUNT - i;
+
+            key = getHeuristicScore(state, card) * (KILLERS_COUNT + 1) + iKillerBonus;
+            key = key * HISTORY_LIMIT + pHistory[idx];
+        }
+
+        // Insertion sort, turns with equal keys keep the cards order
+        unsigned int i = iCount++;
+        for(; i > 0 && aKeys[i - 1] < key; i--)
+        {
+            aKeys[i] = aKeys[i - 1];
+            pTurns[i] = pTurns[i - 1];
+        }
+
+        aKeys[i] = key;
+        pTurns[i] = card;
+    }
+
+    return iCount;
+}
+
+void CMoveOrdering::addCutoff(const CGameState & state, Card turn)
+{
+    const GameStateData & data = state.getStateData();
+    unsigned int iCardsCount = countHandsCards(data);
+
+    Card * pKillers = m_aKillers[iCardsCount];
+    if(pKillers[0] != turn)
+    {
+        pKillers[1] = pKillers[0];
+        pKillers[0] = turn;
+    }
+
+    // Cutoffs close to the root save more, the table is halved so that counters fit
+    // the sort key (see orderTurns())
+    uint32_t & counter = m_aHistory[data.m_iActivePlayer][getCardIdx(turn)];
+    counter += iCardsCount * iCardsCount;
+    if(counter >= HISTORY_LIMIT)
+    {
+        for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+            for(unsigned int j = 0; j < MAX_CARDS; j++)
+                m_aHistory[i][j] /= 2;
+    }
+}
+
+unsigned int CMoveOrdering::getHeuristicScore(const CGameState & state, Card turn) const
+{
+    // Heuristics need sides of the zero sum game
+    unsigned int iTarget = state.getTargetPlayer();
+    if(iTarget >= MAX_PLAYERS)
+        return 0;
+
+    const GameStateData & data = state.getStateData();
+    unsigned int iPlayer = data.m_iActivePlayer;
+    bool bMaximize = isMaxStrategy(state.getActivePlayerStrategy());
+    bool bWantsTricks = (iPlayer == iTarget) == bMaximize;
+
+    CardSuit suit = getSuit(turn);
+    CardSuit trump = static_cast<CardSuit>(data.m_trumpSuit);
+    unsigned int value = getCardValue(turn) - CV_7;
+    unsigned int lowValue = CARDS_IN_SUIT - 1 - value;
+
+    if(data.m_iCardsOnTableCount == 0)
+    {
+        // Lead the top card of the suit to take the trick, or the lowest card to lose it
+        CardMask others = data.m_aHands[0] | data.m_aHands[1] | data.m_aHands[2];
+        others &= ~data.m_aHands[iPlayer];
+        SuitMask othersSuit = getSuitMask(others, suit);
+        if(bWantsTricks)
+            return (othersSuit >> value) == 0 ? 2 * CARDS_IN_SUIT + value : lowValue;
+
+        bool bLowest = othersSuit != 0 && (othersSuit & ((1u << value) - 1)) == 0;
+        return bLowest ? 2 * CARDS_IN_SUIT + lowValue : lowValue;
+    }
+
+    // Find the card, that wins the trick so far
+    Card lead = data.m_aCardsOnTable[0];
+    const auto & ranks = TRICK_CARD_RANKS[getSuitIdx(trump)][getSuitIdx(getSuit(lead))];
+    unsigned int iWinnerPos = 0;
+    for(unsigned int i = 1; i < data.m_iCardsOnTableCount; i++)
+        if(ranks[data.m_aCardsOnTable[i]] > ranks[data.m_aCardsOnTable[iWinnerPos]])
+            iWinnerPos = i;
+
+    // Discard from the shortest suit, keeping long suits (and their winners) intact
+    if(suit != getSuit(lead) && suit != trump)
+    {
+        unsigned int iSuitLength = countCards(data.m_aHands[iPlayer] & getSuitCardsMask(suit));
+        return (CARDS_IN_SUIT - iSuitLength) * CARDS_IN_SUIT + (bWantsTricks ? lowValue : value);
+    }
+
+    unsigned int iWinner = (iPlayer + MAX_PLAYERS - data.m_iCardsOnTableCount + iWinnerPos) % MAX_PLAYERS;
+    bool bTrickIsGood = (iWinner == iTarget) == bMaximize;
+    bool bWins = ranks[turn] > ranks[data.m_aCardsOnTable[iWinnerPos]];
+
+    // Win the trick as cheaply as possible, unless the partner wins it already
+    if(bWantsTricks)
+    {
+        if(bWins && !bTrickIsGood)
+            return 3 * CARDS_IN_SUIT + lowValue;
+
+        return (bWins ? CARDS_IN_SUIT : 2 * CARDS_IN_SUIT) + lowValue;
+    }
+
+    // Get rid of the highest card, that still loses the trick
+    return bWins ? lowValue : 2 * CARDS_IN_SUIT + value;
+}
@@ -0,0 +1,111 @@
+#ifndef MOVE_ORDERING_H
+#define MOVE_ORDERING_H
+
+/**
+ * @file
+ * @brief Move ordering declaration
+ */
+
+#include <cstdint>
+
+#include "CardDefs.h"
+#include "CardPack.h"
+#include "Score.h"
+
+class CGameState;
+
+/**
+ * @brief Move ordering
+ *
+ * Alpha-beta search (see CGameState::searchAlphaBeta()) stops searching turns of a state as
+ * soon as a turn gets the score out of the search window, so the sooner the best turn is
+ * searched, the less turns are searched at all. This class sorts valid turns of the state
+ * so that the most promising ones go first:
+ * - The turn stored in the visited states cache (the hash turn), it was the best one, or it
+ *   caused a cutoff, when the state was searched before
+ * - Turns, that are good according to simple card play heuristics (see getHeuristicScore())
+ * - Killer turns: turns, that caused cutoffs in other states with the same number of cards.
+ *   Such states are often from different tricks, so killers only break ties of heuristics
+ * - Turns, that caused more cutoffs in the whole search so far (history table)
+ * .
+ *
+ * Ordering affects only the speed of the search, the result is the same with any ordering.
+ * Killer turns and the history table are collected while searching, so an ordering object
+ * shall not be shared by simultaneous searches. Heuristics may be replaced in derived classes.
+ */
+class CMoveOrdering
+{
+public:
+    /**
+     * @brief Create move ordering with empty killers and history tables
+     */
+    CMoveOrdering();
+
+    /**
+     * @brief Move ordering destructor
+     */
+    virtual ~CMoveOrdering() = default;
+
+    /**
+     * @brief Clear killers and history tables
+     *
+     * Tables may be kept while solving similar deals, but shall be cleared for unrelated ones.
+     */
+    void clear();
+
+    /**
+     * @brief Sort turns of the state
+     *
+     * @param state     - the state
+     * @param turns     - valid turns of the active player
+     * @param hashTurn  - the turn from the visited states cache, or UNKNOWN_CARD
+     * @param pTurns    - sorted turns, the array shall fit all the turns
+     *
+     * @return number of turns
+     */
+    unsigned int orderTurns(const CGameState & state, CardMask turns, Card hashTurn, Card * pTurns) const;
+
+    /**
+     * @brief Register the turn, that caused a cutoff
+     *
+     * @param state - the state, where the turn was made
+     * @param turn  - the turn
+     */
+    void addCutoff(const CGameState & state, Card turn);
+
+protected:
+    /**
+     * @brief Calculate the heuristic score of the turn
+     *
+     * The score tells how good the turn looks for the active player, if nothing else is
+     * known about the state. The active player wants to take tricks if he is the declarer,
+     * who maximizes his tricks, or a defender, who minimizes declarer's tricks. The heuristic
+     * prefers:
+     * - On lead: to cash the top card of the suit (the top of the sequence) if tricks are
+     *   wanted, otherwise to lead the lowest card
+     * - On the second or third hand: to win the trick with the cheapest card, to play low when
+     *   the partner wins, and to get rid of the highest card, that still loses the trick,
+     *   if tricks are not wanted
+     * - Discard: from the shortest side suit
+     * .
+     *
+     * @param state - the state
+     * @param turn  - valid turn of the active player
+     *
+     * @return the score, greater scores go first (less than HEURISTIC_SCORE_LIMIT)
+     */
+    virtual unsigned int getHeuristicScore(const CGameState & state, Card turn) const;
+
+    /// Upper limit of the heuristic score
+    static const unsigned int HEURISTIC_SCORE_LIMIT = 1024;
+
+    /// Number of killer turns for each number of cards left
+    static const unsigned int KILLERS_COUNT = 2;
+
+    /// Killer turns for each number of cards in players' hands
+    Card m_aKillers[MAX_CARDS + 1][KILLERS_COUNT];
+    /// Cutoffs counters for each player and card index
+    uint32_t m_aHistory[MAX_PLAYERS][MAX_CARDS];
+};
+
+#endif // MOVE_ORDERING_H
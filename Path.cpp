@@ -16,6 +16,17 @@ CPath::CPath(const CScore & score)
 
 }
 
+CPath::CPath(const CScore & score, const Card * pTurns, size_t count)
+    : m_score(score)
+    , m_path(count)
+    , m_strategy(PS_P1MIN)
+    , m_bValid(true)    // Valid, as object has a score
+{
+    // Path is stored reversed
+    for(size_t i = 0; i < count; i++)
+        m_path[count - 1 - i] = pTurns[i];
+}
+
 CPath::CPath(PlayerStrategy strategy)
     : m_strategy(strategy)
     , m_bValid(false)   // Invalid until one or more paths added
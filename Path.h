@@ -51,6 +51,18 @@ public:
      */
     CPath(const CScore & score);
 
+    /**
+     * @brief Create a path object with specified turns
+     *
+     * This constructor creates a valid path object, that leads to the specified score with
+     * specified turns. It is used to restore stored paths (see CVisitedStateCache).
+     *
+     * @param score     - score value at the end of the path
+     * @param pTurns    - turns from the path start
+     * @param count     - number of turns
+     */
+    CPath(const CScore & score, const Card * pTurns, size_t count);
+
     /**
      * @brief Create a intermediate path object
      *
@@ -95,6 +107,30 @@ public:
      */
     std::string getOptimalPath() const;
 
+    /**
+     * @brief Retrieve number of turns in the optimal path
+     *
+     * @return number of turns
+     */
+    inline size_t getTurnsCount() const
+    {
+        return m_path.size();
+    }
+
+    /**
+     * @brief Retrieve the turn of the optimal path
+     *
+     * @note To increase performance, this method does not check the index
+     *
+     * @param idx   - zero based turn index from the path start
+     *
+     * @return card played at the turn
+     */
+    inline Card getTurn(size_t idx) const
+    {
+        return m_path[m_path.size() - 1 - idx];
+    }
+
     /**
      * @brief Process a possible subpath
      *
@@ -39,20 +39,24 @@ std::ostream& operator<< (std::ostream& out, const CPlayer & player)
 }
 
 CCardPack CPlayer::getListOfValidTurns(CardSuit suit, CardSuit trump)
+{
+    return getValidTurns(m_cardPack, suit, trump);
+}
+
+CCardPack CPlayer::getValidTurns(const CCardPack & cards, CardSuit suit, CardSuit trump)
 {
     // All cards are valid if no suit specified
     if(suit == CS_UNKNOWN)
-        return m_cardPack;
+        return cards;
 
     // Search for requested suit first
-    if(m_cardPack.hasSuit(suit))
-        return m_cardPack.getSubset(suit);
+    if(cards.hasSuit(suit))
+        return cards.getSubset(suit);
 
     // Then search for trumps
-    if(m_cardPack.hasSuit(trump))
-        return m_cardPack.getSubset(trump);
+    if(cards.hasSuit(trump))
+        return cards.getSubset(trump);
 
     // Otherwise all the remaining cards are valid
-    return m_cardPack;
+    return cards;
 }
-
@@ -117,6 +117,20 @@ public:
      */
     CCardPack getListOfValidTurns(CardSuit suit, CardSuit trump = CS_UNKNOWN);
 
+    /**
+     * @brief Return a list of valid turns for the given cards
+     *
+     * This method is the same as getListOfValidTurns(), but works with the given cards
+     * instead of player's ones, so that it can be used without player objects.
+     *
+     * @param cards - cards of the player
+     * @param suit  - the suit of the current trick (or \a CS_UNKNOWN)
+     * @param trump - the trump suit of the current game
+     *
+     * @return filtered card pack that has only valid turns
+     */
+    static CCardPack getValidTurns(const CCardPack & cards, CardSuit suit, CardSuit trump = CS_UNKNOWN);
+
     /**
      * @brief Remove card from player's cards
      *
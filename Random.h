@@ -0,0 +1,166 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+/**
+ * @file
+ * @brief Pseudo random numbers generator
+ */
+
+#include <cstdint>
+
+/**
+ * @brief Pseudo random numbers generator
+ *
+ * This is a xoshiro256** generator: it is fast, has small state, and good statistical
+ * properties. Unlike std::random_device based generators its output is completely defined
+ * by the seed, so results can be reproduced.
+ *
+ * Independent streams (e.g. one per worker thread) are made with jump() function: each
+ * stream starts 2^128 numbers after the previous one, so streams never overlap.
+ */
+class CRandomGenerator
+{
+public:
+    /**
+     * @brief Create a generator
+     *
+     * Generator state is initialized from the seed using splitmix64 generator, as recommended
+     * by xoshiro authors. Then the generator jumps to the requested stream.
+     *
+     * @note Stream initialization takes time proportional to the stream index
+     *
+     * @param seed      - generator seed
+     * @param stream    - zero based index of the stream
+     */
+    explicit CRandomGenerator(uint64_t seed, uint64_t stream = 0)
+    {
+        for(unsigned int i = 0; i < 4; i++)
+        {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            m_aState[i] = z ^ (z >> 31);
+        }
+
+        for(; stream > 0; stream--)
+            jump();
+    }
+
+    /**
+     * @brief Generate next number
+     *
+     * @return 64 bit pseudo random number
+     */
+    inline uint64_t next()
+    {
+        uint64_t res = rotl(m_aState[1] * 5, 7) * 9;
+        uint64_t t = m_aState[1] << 17;
+
+        m_aState[2] ^= m_aState[0];
+        m_aState[3] ^= m_aState[1];
+        m_aState[1] ^= m_aState[2];
+        m_aState[0] ^= m_aState[3];
+        m_aState[2] ^= t;
+        m_aState[3] = rotl(m_aState[3], 45);
+
+        return res;
+    }
+
+    /**
+     * @brief Generate a number in the range
+     *
+     * The number is generated without bias using Lemire's multiply and shift method. Division
+     * is needed only in rare cases when the number has to be regenerated.
+     *
+     * @param range - upper bound of the range (exclusive), shall not be zero
+     *
+     * @return a number in range [0, range)
+     */
+    inline uint32_t getBounded(uint32_t range)
+    {
+        return getBounded(static_cast<uint32_t>(next() >> 32), range);
+    }
+
+    /**
+     * @brief Generate two numbers in the ranges
+     *
+     * This is equivalent to two getBounded() calls, but both numbers are usually made
+     * of a single generated number (its high and low halves)
+     *
+     * @param range1    - upper bound of the first number range (exclusive), shall not be zero
+     * @param range2    - upper bound of the second number range (exclusive), shall not be zero
+     * @param res1      - first generated number
+     * @param res2      - second generated number
+     */
+    inline void getBoundedPair(uint32_t range1, uint32_t range2, uint32_t & res1, uint32_t & res2)
+    {
+        uint64_t x = next();
+        res1 = getBounded(static_cast<uint32_t>(x >> 32), range1);
+        res2 = getBounded(static_cast<uint32_t>(x), range2);
+    }
+
+    /**
+     * @brief Advance the generator by 2^128 numbers
+     *
+     * This is equivalent to 2^128 calls to next(), so that it can be used to make
+     * non-overlapping streams.
+     */
+    void jump()
+    {
+        const uint64_t aJump[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+
+        uint64_t aState[4] = {0, 0, 0, 0};
+        for(uint64_t jump : aJump)
+            for(unsigned int bit = 0; bit < 64; bit++)
+            {
+                if(jump & (uint64_t(1) << bit))
+                {
+                    for(unsigned int i = 0; i < 4; i++)
+                        aState[i] ^= m_aState[i];
+                }
+                next();
+            }
+
+        for(unsigned int i = 0; i < 4; i++)
+            m_aState[i] = aState[i];
+    }
+
+protected:
+    /**
+     * @brief Map 32 bit random number to the range
+     *
+     * @param x     - random number
+     * @param range - upper bound of the range (exclusive)
+     *
+     * @return a number in range [0, range)
+     */
+    inline uint32_t getBounded(uint32_t x, uint32_t range)
+    {
+        uint64_t m = uint64_t(x) * range;
+        uint32_t low = static_cast<uint32_t>(m);
+        if(low < range)
+        {
+            // Rare case: the number gets into the biased part, and has to be regenerated
+            uint32_t threshold = (0u - range) % range;
+            while(low < threshold)
+            {
+                m = (next() >> 32) * range;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    /// Rotate the value left
+    static inline uint64_t rotl(uint64_t x, unsigned int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    /// Generator state
+    uint64_t m_aState[4];
+};
+
+#endif // RANDOM_H
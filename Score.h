@@ -7,6 +7,7 @@
  */
 
 #include <iostream>
+#include <cstdint>
 
 /// The player strategy
 enum PlayerStrategy
@@ -28,6 +29,30 @@ enum PlayerStrategy
 /// Number of players in the game
 const unsigned int MAX_PLAYERS = 3;
 
+/**
+ * @brief Retrieve the player the strategy refers to
+ *
+ * @param eStrategy - the player strategy
+ *
+ * @return zero based index of the player, whose tricks are minimized or maximized
+ */
+inline unsigned int getStrategyPlayer(PlayerStrategy eStrategy)
+{
+    return static_cast<unsigned int>(eStrategy) / 2;
+}
+
+/**
+ * @brief Check if the strategy maximizes tricks
+ *
+ * @param eStrategy - the player strategy
+ *
+ * @return \a true if the strategy maximizes tricks, \a false if it minimizes them
+ */
+inline bool isMaxStrategy(PlayerStrategy eStrategy)
+{
+    return (static_cast<unsigned int>(eStrategy) & 1) != 0;
+}
+
 /**
  * @brief Game score class
  *
@@ -70,23 +95,19 @@ public:
     /**
      * @brief Game score copy constructor
      *
-     * This constructor will copy specified score
+     * This constructor will copy specified score. The score is trivially copyable, so that
+     * it can be a part of packed game states.
      *
      * @param rScore - score to copy
      */
-    CScore(const CScore & rScore)
-    {
-        m_uPlayersScore.lPlayersScore = rScore.m_uPlayersScore.lPlayersScore;
-    }
+    CScore(const CScore & rScore) = default;
     
     /**
      * @brief Game score destructor
      *
-     * This destructor will release internal data
+     * This destructor does nothing, as there is no data to free.
      */
-    ~CScore()
-    {
-    }
+    ~CScore() = default;
     
 ///@name Operators
 //@{
@@ -100,15 +121,7 @@ public:
      * 
      * @return reference to this object
      */
-    inline CScore& operator=(const CScore& rScore)
-    {
-        if(this != &rScore)
-        {
-            m_uPlayersScore.lPlayersScore = rScore.m_uPlayersScore.lPlayersScore;
-        }
-    
-        return *this;
-    }
+    CScore& operator=(const CScore& rScore) = default;
 
     /**
      * @brief Less than operator
@@ -124,6 +137,50 @@ public:
         return (m_uPlayersScore.lPlayersScore < rScore.m_uPlayersScore.lPlayersScore);
     }
 
+    /**
+     * @brief Equivalence operator
+     *
+     * @param rScore - object to compare with
+     *
+     * @return \a true if scores of all players are equal
+     */
+    inline bool operator==(const CScore & rScore) const
+    {
+        return (m_uPlayersScore.lPlayersScore == rScore.m_uPlayersScore.lPlayersScore);
+    }
+
+    /**
+     * @brief Add the score
+     *
+     * This operator adds scores of each player. Players' scores never exceed a byte, so
+     * the whole score is added as a single value.
+     *
+     * @param rScore - score to add
+     *
+     * @return reference to this object
+     */
+    inline CScore& operator+=(const CScore & rScore)
+    {
+        m_uPlayersScore.lPlayersScore += rScore.m_uPlayersScore.lPlayersScore;
+        return *this;
+    }
+
+    /**
+     * @brief Subtract the score
+     *
+     * This operator subtracts scores of each player. Scores of each player shall not be
+     * less than the subtracted ones.
+     *
+     * @param rScore - score to subtract
+     *
+     * @return reference to this object
+     */
+    inline CScore& operator-=(const CScore & rScore)
+    {
+        m_uPlayersScore.lPlayersScore -= rScore.m_uPlayersScore.lPlayersScore;
+        return *this;
+    }
+
     /**
      * @brief serialization operator
      *
@@ -205,7 +262,7 @@ protected:
         /// Players score array
         unsigned char vPlayerScore[MAX_PLAYERS];
         /// Players score, presented as single integer value
-        unsigned long lPlayersScore;
+        uint32_t lPlayersScore;
     } m_uPlayersScore;
 };
 
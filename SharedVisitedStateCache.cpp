@@ -0,0 +1,222 @@
+#include "SharedVisitedStateCache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+/// How long to wait for the segment creator to initialize the segment
+const unsigned int SEGMENT_WAIT_MS = 1000;
+
+} // namespace
+
+CSharedVisitedStateCache::CSharedVisitedStateCache(const char * name, size_t iSizeMB)
+    : CVisitedStateCache(iSizeMB, false)
+    , m_pSegment(nullptr)
+    , m_iSegmentSize(0)
+{
+#if defined(_WIN32)
+    (void)name;
+    throw "CSharedVisitedStateCache::CSharedVisitedStateCache(): Shared memory is not supported";
+#else
+    // The one who manages to create the segment initializes it. Entries are trusted by all
+    // processes, so the segment is accessible by the owner only
+    for(unsigned int iAttempt = 0; !m_pSegment; iAttempt++)
+    {
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd >= 0)
+        {
+            m_pSegment = createSegment(fd);
+            close(fd);
+            if(!m_pSegment)
+            {
+                shm_unlink(name);
+                throw "CSharedVisitedStateCache::CSharedVisitedStateCache(): Cannot create the segment";
+            }
+
+            break;
+        }
+
+        fd = shm_open(name, O_RDWR, 0);
+        if(fd < 0)
+            throw "CSharedVisitedStateCache::CSharedVisitedStateCache(): Cannot open the segment";
+
+        m_pSegment = openSegment(fd);
+        bool bStale = !m_pSegment && iAttempt == 0 && isStaleSegment(name, fd);
+        close(fd);
+
+        // The segment, that the creator has not finished, is removed and created once more
+        if(!m_pSegment && !bStale)
+            throw "CSharedVisitedStateCache::CSharedVisitedStateCache(): Invalid segment";
+        if(bStale)
+            shm_unlink(name);
+    }
+
+    // Partitions go one by one after the header
+    const CacheFileHeader * pHeader = static_cast<const CacheFileHeader *>(m_pSegment);
+    CacheBucket * pBuckets = reinterpret_cast<CacheBucket *>(static_cast<char *>(m_pSegment) + sizeof(CacheFileHeader));
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+    {
+        size_t iBucketsCount = static_cast<size_t>(pHeader->m_aBucketsCounts[i]);
+        setPartitionBuckets(i, pBuckets, iBucketsCount);
+        pBuckets += iBucketsCount;
+    }
+#endif
+}
+
+CSharedVisitedStateCache::~CSharedVisitedStateCache()
+{
+#if !defined(_WIN32)
+    if(m_pSegment)
+        munmap(m_pSegment, m_iSegmentSize);
+#endif
+}
+
+void CSharedVisitedStateCache::setPartitionSize(unsigned int iPartition, size_t iSizeKB)
+{
+    (void)iPartition;
+    (void)iSizeKB;
+    throw "CSharedVisitedStateCache::setPartitionSize(): Partitions of the shared cache cannot be resized";
+}
+
+bool CSharedVisitedStateCache::removeSharedCache(const char * name)
+{
+#if defined(_WIN32)
+    (void)name;
+    return false;
+#else
+    return shm_unlink(name) == 0;
+#endif
+}
+
+void * CSharedVisitedStateCache::createSegment(int fd)
+{
+#if defined(_WIN32)
+    (void)fd;
+    return nullptr;
+#else
+    CacheFileHeader header;
+    initHeader(header);
+
+    size_t iSize = sizeof(CacheFileHeader);
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+        iSize += static_cast<size_t>(header.m_aBucketsCounts[i]) * sizeof(CacheBucket);
+
+    // New segment is filled with zeros, i.e. all entries are empty
+    if(ftruncate(fd, static_cast<off_t>(iSize)) != 0)
+        return nullptr;
+
+    void * pSegment = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(pSegment == MAP_FAILED)
+        return nullptr;
+
+    // The magic is written the last, so that others see the segment as valid only when
+    // the header is complete
+    CacheFileHeader * pHeader = static_cast<CacheFileHeader *>(pSegment);
+    memcpy(pHeader, &header, sizeof(header));
+    memset(pHeader->m_aMagic, 0, sizeof(pHeader->m_aMagic));
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(pHeader->m_aMagic, header.m_aMagic, sizeof(pHeader->m_aMagic));
+
+    m_iSegmentSize = iSize;
+    return pSegment;
+#endif
+}
+
+bool CSharedVisitedStateCache::isStaleSegment(const char * name, int fd)
+{
+#if defined(_WIN32)
+    (void)name;
+    (void)fd;
+    return false;
+#else
+    struct stat segmentStat;
+    if(fstat(fd, &segmentStat) != 0)
+        return false;
+
+    // The creator initializes the segment right after it is created, so the magic is missing
+    // for long only if the creator is dead
+    if(time(nullptr) - segmentStat.st_ctime < static_cast<time_t>(SEGMENT_WAIT_MS / 1000))
+        return false;
+
+    size_t iSize = static_cast<size_t>(segmentStat.st_size);
+    if(iSize >= sizeof(CacheFileHeader))
+    {
+        void * pSegment = mmap(nullptr, sizeof(CacheFileHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if(pSegment == MAP_FAILED)
+            return false;
+
+        const char aZeros[sizeof(CacheFileHeader::m_aMagic)] = {};
+        bool bEmpty = memcmp(static_cast<const CacheFileHeader *>(pSegment)->m_aMagic, aZeros, sizeof(aZeros)) == 0;
+        munmap(pSegment, sizeof(CacheFileHeader));
+        if(!bEmpty)
+            return false;
+    }
+
+    // The name shall still refer to the same segment, as another process may have replaced
+    // the stale segment already
+    int nameFd = shm_open(name, O_RDONLY, 0);
+    if(nameFd < 0)
+        return false;
+
+    struct stat nameStat;
+    bool bSame = fstat(nameFd, &nameStat) == 0 && nameStat.st_ino == segmentStat.st_ino;
+    close(nameFd);
+    return bSame;
+#endif
+}
+
+void * CSharedVisitedStateCache::openSegment(int fd)
+{
+#if defined(_WIN32)
+    (void)fd;
+    return nullptr;
+#else
+    // The segment may be still initialized by its creator
+    for(unsigned int i = 0; i < SEGMENT_WAIT_MS; i++)
+    {
+        struct stat segmentStat;
+        if(fstat(fd, &segmentStat) != 0)
+            return nullptr;
+
+        size_t iSize = static_cast<size_t>(segmentStat.st_size);
+        if(iSize >= sizeof(CacheFileHeader))
+        {
+            void * pSegment = mmap(nullptr, iSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(pSegment == MAP_FAILED)
+                return nullptr;
+
+            const CacheFileHeader * pHeader = static_cast<const CacheFileHeader *>(pSegment);
+            if(memcmp(pHeader->m_aMagic, CACHE_FILE_MAGIC, sizeof(pHeader->m_aMagic)) == 0)
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(!isValidHeader(pHeader, iSize))
+                {
+                    munmap(pSegment, iSize);
+                    return nullptr;
+                }
+
+                m_iSegmentSize = iSize;
+                return pSegment;
+            }
+
+            munmap(pSegment, iSize);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return nullptr;
+#endif
+}
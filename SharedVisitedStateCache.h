@@ -0,0 +1,118 @@
+#ifndef SHAREDVISITEDSTATECACHE_H
+#define SHAREDVISITEDSTATECACHE_H
+
+/**
+ * @file
+ * @brief The Shared visited states cache declaration
+ */
+
+#include "VisitedStateCache.h"
+
+/**
+ * @brief Visited States Cache in shared memory
+ *
+ * This is a visited states cache, which partitions are placed in a named POSIX shared memory
+ * segment, so that several solver processes (e.g. solving Monte Carlo samples of the same
+ * deal) use states found by each other. It is used just like CVisitedStateCache, e.g. passed
+ * to CGameState::setVisitedStatesCache().
+ *
+ * The first process creates the segment with the cache file layout (see
+ * CVisitedStateCache::saveToFile()), the others take the layout from the segment, so the
+ * size passed to them is ignored. The segment is accessible by the user, that created it,
+ * only. The segment lives until it is removed with removeSharedCache(), even if all
+ * processes are finished. If the creator dies before the segment is initialized, the next
+ * process removes it and creates a new one.
+ *
+ * There are no locks. Entry keys are locked with entry data (see CVisitedStateCache::lockKey()),
+ * so an entry that is torn by concurrent writes is just not found. Losing an entry this way
+ * does not affect the search result, the state is searched once more.
+ *
+ * Search generations (see newSearch()) are counted by each process, so entries of other
+ * processes may be considered old, and replaced first.
+ *
+ * @note Shared memory is not supported on Windows, the constructor throws there
+ */
+class CSharedVisitedStateCache : public CVisitedStateCache
+{
+public:
+    /**
+     * @brief Create the cache, or connect to an existing one
+     *
+     * @throw "const char *" exception if the segment cannot be created or mapped, or
+     *        the existing segment is not a valid cache
+     *
+     * @param name      - shared memory segment name (shall start with '/', e.g. "/preferans")
+     * @param iSizeMB   - size of the cache in megabytes, if the segment is created
+     */
+    CSharedVisitedStateCache(const char * name, size_t iSizeMB = DEFAULT_CACHE_SIZE_MB);
+
+    /**
+     * @brief Disconnect from the shared memory segment
+     *
+     * The segment is not removed, see removeSharedCache()
+     */
+    ~CSharedVisitedStateCache();
+
+    /**
+     * @brief Set the partition size
+     *
+     * Partitions of the shared cache take the layout of the segment, they cannot be resized
+     *
+     * @throw "const char *" always
+     *
+     * @param iPartition    - partition index (see getPartitionIdx())
+     * @param iSizeKB       - partition size in kilobytes
+     */
+    void setPartitionSize(unsigned int iPartition, size_t iSizeKB) override;
+
+    /**
+     * @brief Remove the shared memory segment
+     *
+     * Processes, that are connected to the segment, continue to use it. New caches with
+     * the same name create a new segment.
+     *
+     * @param name  - shared memory segment name
+     *
+     * @return \a true if the segment is removed, \a false if there is no such segment
+     */
+    static bool removeSharedCache(const char * name);
+
+protected:
+    /**
+     * @brief Create a new segment with the current partitions layout
+     *
+     * @param fd    - descriptor of the segment, that is just created
+     *
+     * @return mapped segment, or nullptr on error
+     */
+    void * createSegment(int fd);
+
+    /**
+     * @brief Check if the segment is left uninitialized by its creator
+     *
+     * @param name  - shared memory segment name
+     * @param fd    - descriptor of the segment
+     *
+     * @return \a true if the segment has no valid magic for longer than the creator needs
+     *         to initialize it, and the name still refers to this segment
+     */
+    static bool isStaleSegment(const char * name, int fd);
+
+    /**
+     * @brief Map an existing segment
+     *
+     * Waits for the creator to initialize the segment
+     *
+     * @param fd    - descriptor of the segment
+     *
+     * @return mapped segment, or nullptr on error
+     */
+    void * openSegment(int fd);
+
+    /// Mapped shared memory segment
+    void * m_pSegment;
+    /// Size of the shared memory segment
+    size_t m_iSegmentSize;
+};
+
+#endif // SHAREDVISITEDSTATECACHE_H
@@ -1,4 +1,11 @@
 #include <sstream>
+#include <fstream>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <catch2/catch.hpp>
 #include "CardDefs.h"
@@ -6,8 +13,14 @@
 #include "Score.h"
 #include "Player.h"
 #include "GameState.h"
+#include "MoveOrdering.h"
 #include "Path.h"
 #include "VisitedStateCache.h"
+#include "SharedVisitedStateCache.h"
+#include "Deal.h"
+#include "DealParser.h"
+#include "DealGenerator.h"
+#include "DealRanker.h"
 
 template<class T>
 std::string getObjStr(T obj)
@@ -132,6 +145,32 @@ TEST_CASE( "Card comparison", "Cards" )
                             CS_CLUBS) == 1);
 }
 
+TEST_CASE( "Card comparison lookup tables", "Cards" )
+{
+    // Build all possible cards, including cards of unknown suit
+    std::vector<Card> cards;
+    const CardSuit suits[] = {CS_SPIDES, CS_CLUBS, CS_DIAMONDS, CS_HEARTS, CS_UNKNOWN};
+    for(CardSuit suit : suits)
+        for(unsigned int value = 0; value <= CARD_VALUE_MASK; value++)
+            cards.push_back(MAKE_CARD(suit, value));
+
+    // Compare table driven functions with the reference ones for every combination
+    unsigned int iMismatches = 0;
+    for(CardSuit trump : suits)
+        for(Card card1 : cards)
+            for(Card card2 : cards)
+            {
+                if(lookupCardHeigher(card1, card2, trump) != isCardHeigher(card1, card2, trump))
+                    iMismatches++;
+
+                for(Card card3 : cards)
+                    if(lookupTrickWinner(card1, card2, card3, trump) != calcTrickWinner(card1, card2, card3, trump))
+                        iMismatches++;
+            }
+
+    REQUIRE(iMismatches == 0);
+}
+
 TEST_CASE( "Card Pack creation and basic operations", "Card Pack")
 {
     // Check card pack creation (Note, cards are shuffled)
@@ -169,6 +208,41 @@ TEST_CASE( "Card Pack creation and basic operations", "Card Pack")
     REQUIRE(pack3.getPackStr() == " 9^ Q^ K^ ?? ?? ??");
 }
 
+TEST_CASE( "Card masks", "Cards" )
+{
+    // Card indexes go in the same order as cards
+    REQUIRE(getCardIdx(MAKE_CARD(CS_SPIDES, CV_7)) == 0);
+    REQUIRE(getCardIdx(MAKE_CARD(CS_SPIDES, CV_ACE)) == 7);
+    REQUIRE(getCardIdx(MAKE_CARD(CS_CLUBS, CV_7)) == 8);
+    REQUIRE(getCardIdx(MAKE_CARD(CS_HEARTS, CV_ACE)) == 31);
+
+    // Check all cards can be converted back and forth
+    for(unsigned int i=0; i<MAX_CARDS; i++)
+    {
+        REQUIRE(isPreferansCard(getCardByIdx(i)));
+        REQUIRE(getCardIdx(getCardByIdx(i)) == i);
+    }
+
+    // Cards that are not in Preferans deck
+    REQUIRE(isPreferansCard(MAKE_CARD(CS_SPIDES, CV_6)) == false);
+    REQUIRE(isPreferansCard(UNKNOWN_CARD) == false);
+
+    // Suit masks
+    REQUIRE(getSuitCardsMask(CS_SPIDES) == 0x000000ff);
+    REQUIRE(getSuitCardsMask(CS_HEARTS) == 0xff000000);
+
+    // Card pack masks
+    CCardPack pack("7^ A^ 7+ A@ ??");
+    REQUIRE(pack.getCardsMask() == 0x80000181);
+    REQUIRE(pack.getCardsCount() == 5);
+    REQUIRE(CCardPack(pack.getCardsMask()).getPackStr() == " 7^ A^ 7+ A@");
+
+    // Cards that cannot be handled by a card pack
+    REQUIRE_THROWS(CCardPack("7^ 6^"));
+    REQUIRE_THROWS(CCardPack("7^ 7^"));
+    REQUIRE_THROWS(CCardPack("7^ 8^") + CCardPack("8^ 9^"));
+}
+
 TEST_CASE( "Card Pack additions/removal", "Card Pack")
 {
     // Make 2 non-intersecting card packs
@@ -222,6 +296,15 @@ TEST_CASE( "Card Pack - randomization", "Card Pack")
     // Check that all cards are still there
     CCardPack combined = pack + subPack;
     REQUIRE(combined.getPackStr() == " 7^ 8^ 9^ 7+ 8+ 9+ 7$ 8$ 9$ 7@ 8@ 9@");
+
+    // The same seed gives the same split
+    CCardPack pack1("7^ 8^ 9^ 7+ 8+ 9+ 7$ 8$ 9$ 7@ 8@ 9@ ?? ??");
+    CCardPack pack2 = pack1;
+    CRandomGenerator random1(42);
+    CRandomGenerator random2(42);
+    REQUIRE(pack1.extractRandomCards(7, random1) == pack2.extractRandomCards(7, random2));
+    REQUIRE(pack1 == pack2);
+    REQUIRE(pack1.getCardsCount() == 7);
 }
 
 TEST_CASE( "Card Pack - card equivalence", "Card Pack")
@@ -298,6 +381,26 @@ TEST_CASE( "Card Pack - card equivalence", "Card Pack")
     }
 }
 
+TEST_CASE( "Card Pack - representative cards table", "Card Pack")
+{
+    // 7 8 9 of the suit are player's, 10 is outstanding, J is player's
+    REQUIRE(getRepresentativeCards(0x17, 0x1f) == 0x14);
+
+    // Played out cards do not separate player's cards
+    REQUIRE(getRepresentativeCards(0x11, 0x11) == 0x10);
+
+    // No own cards - nothing to play
+    REQUIRE(getRepresentativeCards(0x00, 0xff) == 0x00);
+
+    // Interleaved with outstanding cards - all cards are representative
+    REQUIRE(getRepresentativeCards(0x55, 0xff) == 0x55);
+
+    // Suit masks conversion
+    CCardPack pack("7^ 9+ J+ A@");
+    REQUIRE(getSuitMask(pack.getCardsMask(), CS_CLUBS) == 0x14);
+    REQUIRE(makeCardMask(0x14, CS_CLUBS) == CCardPack("9+ J+").getCardsMask());
+}
+
 TEST_CASE("Check main CScore operations", "Score")
 {
     // Create and fill score object
@@ -328,6 +431,11 @@ TEST_CASE("Check main CScore operations", "Score")
     REQUIRE((score < score2) == false);
     REQUIRE((score2 < score) == true);
 
+    // Add and subtract scores
+    score += CScore(1, 2, 3);
+    REQUIRE(getObjStr(score) == "(5, 4, 4)");
+    score -= CScore(2, 4, 0);
+    REQUIRE(getObjStr(score) == "(3, 0, 4)");
 }
 
 TEST_CASE("CScore player strategies", "Score")
@@ -396,6 +504,253 @@ TEST_CASE("Game State", "Game State")
         CCardPack allCards = state.getCardsLeft();
         REQUIRE(getObjStr(allCards) == " 7^ 9^ K^ 7+ 9+ J+ 7$ Q$ K$");
     }
+
+    SECTION("Make and unmake turns")
+    {
+        std::string initialState = getObjStr(state);
+
+        // Play the whole trick, and one more card
+        const char * aCards[] = {"7^", "9^", "K^", "J+"};
+        TurnUndoInfo aUndo[4];
+        for(unsigned int i = 0; i < 4; i++)
+            state.makeTurn(parseCard(aCards[i]), aUndo[i]);
+
+        // King of spides wins the trick, 3rd player leads the next one
+        REQUIRE(getObjStr(state) != initialState);
+        REQUIRE(state.getActivePlayer() == 0);
+        REQUIRE(state.getCurrentSuit() == CS_CLUBS);
+
+        // Cards of the completed trick are out of game, the current trick cards are still there
+        REQUIRE(getObjStr(state.getCardsLeft()) == " 7+ 9+ J+ 7$ Q$ K$");
+
+        // Take all the turns back
+        for(unsigned int i = 4; i > 0; i--)
+            state.unmakeTurn(aUndo[i - 1]);
+
+        REQUIRE(getObjStr(state) == initialState);
+        REQUIRE(state.getActivePlayer() == 0);
+        REQUIRE(state.getCurrentSuit() == CS_UNKNOWN);
+    }
+
+    SECTION("Pack and unpack the state")
+    {
+        state.setTrumpSuit(CS_HEARTS);
+        state.setScore(CScore(1, 0, 2));
+        state.makeTurn(parseCard("9+"));
+        state.makeTurn(parseCard("7+"));
+
+        GameStateKey key;
+        state.getStateData().pack(key);
+
+        // Score is not packed
+        GameStateData data;
+        data.unpack(key);
+        REQUIRE(data.m_score == CScore());
+        data.m_score = state.getStateData().m_score;
+        REQUIRE(data == state.getStateData());
+        REQUIRE(data.m_cardsLeft == state.getStateData().m_cardsLeft);
+
+        // Different states have different keys
+        GameStateKey key2;
+        state.makeTurn(parseCard("J+"));
+        state.getStateData().pack(key2);
+        REQUIRE(!(key == key2));
+    }
+}
+
+TEST_CASE("Game solving", "Game State")
+{
+    // A famous "Kovalevska's miser" game
+    CGameState game(CPlayer("J^ Q^   7+ 9+   1$ J$ Q$ K$   7@ J@", PS_P2MAX),
+                    CPlayer("7^ 8^ 9^ 1^   8+   7$ 8$ 9$   8@ 9@", PS_P2MIN),
+                    CPlayer("K^ A^   1+ J+ Q+   A$   1@ Q@ K@ A@", PS_P2MAX));
+    std::string initialState = getObjStr(game);
+
+    CVisitedStateCache cache;
+    game.setVisitedStatesCache(&cache);
+    CPath path = game.playGameRecursive();
+    game.setVisitedStatesCache(nullptr);
+
+    REQUIRE(getObjStr(path.getOptimalScore()) == "(6, 1, 3)");
+    REQUIRE(path.getOptimalPath() == " K$ 9$ A$ 1@ J@ 9@ Q$ 8$ A^ J$ 7$ K^ 1$ 1^ Q+ Q^ 9^ J+ J^ 8^ 1+ 7+ 8+ A@ 8@ K@ 7@ Q@ 9+ 7^");
+
+    // Search does not change the state
+    REQUIRE(getObjStr(game) == initialState);
+    REQUIRE(game.isZeroSumGame() == true);
+}
+
+/// Game state, that is always searched with max-n algorithm
+class CMaxNGameState : public CGameState
+{
+public:
+    using CGameState::CGameState;
+
+    CScore searchMaxN(Card & bestTurn)
+    {
+        return CGameState::searchMaxN(bestTurn);
+    }
+};
+
+TEST_CASE("Alpha-beta search", "Game State")
+{
+    // Endings made of the lowest cards of random deals
+    CDealGenerator generator(2024);
+    for(unsigned int iDeal = 0; iDeal < 20; iDeal++)
+    {
+        Deal deal;
+        generator.generateDeal(deal);
+
+        CardMask aHands[MAX_PLAYERS];
+        for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        {
+            aHands[i] = 0;
+            CardMask cards = deal.m_aHands[i];
+            for(unsigned int j = 0; j < 5; j++, cards &= cards - 1)
+                aHands[i] |= cards & (0 - cards);
+        }
+
+        PlayerStrategy defender = (iDeal % 2) ? PS_P1MIN : PS_P1MAX;
+        PlayerStrategy declarer = (iDeal % 2) ? PS_P1MAX : PS_P1MIN;
+        CPlayer player1(CCardPack(aHands[0]), declarer);
+        CPlayer player2(CCardPack(aHands[1]), defender);
+        CPlayer player3(CCardPack(aHands[2]), defender);
+
+        CMaxNGameState maxNGame(player1, player2, player3);
+        CGameState game(player1, player2, player3);
+        CardSuit trump = (iDeal % 5 == 4) ? CS_UNKNOWN : static_cast<CardSuit>((iDeal % 4) << 4);
+        maxNGame.setTrumpSuit(trump);
+        game.setTrumpSuit(trump);
+        REQUIRE(game.isZeroSumGame() == true);
+
+        // Static bounds hold the optimal score
+        Card maxNTurn, turn;
+        CScore maxNScore = maxNGame.searchMaxN(maxNTurn);
+        int iLower, iUpper;
+        game.getTargetScoreBounds(iLower, iUpper);
+        REQUIRE(iLower <= maxNScore.getPlayerScore(0));
+        REQUIRE(iUpper >= maxNScore.getPlayerScore(0));
+
+        // Alpha-beta selects the same turns, as there are no cutoffs with the full window.
+        // Only the score of the target player is searched
+        REQUIRE(game.searchOptimalTurn(turn).getPlayerScore(0) == maxNScore.getPlayerScore(0));
+        REQUIRE(turn == maxNTurn);
+
+        // Same with bounds from the cache
+        CVisitedStateCache cache(1);
+        for(unsigned int i = 0; i < CVisitedStateCache::PARTITIONS_COUNT; i++)
+            cache.setPartitionEnabled(i, true);
+        game.setVisitedStatesCache(&cache);
+        REQUIRE(game.playGameRecursive().getOptimalScore() == maxNScore);
+        REQUIRE(game.searchOptimalTurn(turn).getPlayerScore(0) == maxNScore.getPlayerScore(0));
+        REQUIRE(turn == maxNTurn);
+
+        // Null window searches get the same value and turn
+        CVisitedStateCache cache2(1);
+        game.setVisitedStatesCache(&cache2);
+        REQUIRE(game.searchOptimalTurn(turn).getPlayerScore(0) == maxNScore.getPlayerScore(0));
+        REQUIRE(turn == maxNTurn);
+
+        // Move ordering changes only the number of searched states
+        CMoveOrdering ordering;
+        CVisitedStateCache cache3(1);
+        game.setVisitedStatesCache(&cache3);
+        game.setMoveOrdering(&ordering);
+        REQUIRE(game.searchOptimalTurn(turn).getPlayerScore(0) == maxNScore.getPlayerScore(0));
+        REQUIRE(turn == maxNTurn);
+        game.setVisitedStatesCache(nullptr);
+        REQUIRE(game.searchOptimalTurn(turn).getPlayerScore(0) == maxNScore.getPlayerScore(0));
+        REQUIRE(turn == maxNTurn);
+    }
+
+    // The declarer on lead cashes his top cards
+    int iLower, iUpper;
+    CGameState topCardsGame(CPlayer("A^ K^ A+", PS_P1MAX), CPlayer("7^ 8^ 7+", PS_P1MIN), CPlayer("9^ 1^ 8+", PS_P1MIN));
+    topCardsGame.setTrumpSuit(CS_UNKNOWN);
+    topCardsGame.getTargetScoreBounds(iLower, iUpper);
+    REQUIRE(iLower == 3);
+    REQUIRE(iUpper == 3);
+
+    // Top cards of side suits are not safe, while defenders have more trumps
+    CGameState trumpsGame(CPlayer("A^ A+ K+", PS_P1MAX), CPlayer("7^ 8^ 7+", PS_P1MIN), CPlayer("9^ 1+ 8+", PS_P1MIN));
+    trumpsGame.setTrumpSuit(CS_SPIDES);
+    trumpsGame.getTargetScoreBounds(iLower, iUpper);
+    REQUIRE(iLower == 1);
+    REQUIRE(iUpper == 3);
+
+    // The defender on lead cashes his top cards as well
+    CGameState defenderGame(CPlayer("7+ 7^ 8^", PS_P1MAX), CPlayer("A+ A^ K^", PS_P1MIN), CPlayer("8+ 9^ 1^", PS_P1MIN));
+    defenderGame.setTrumpSuit(CS_UNKNOWN);
+    defenderGame.makeTurn(parseCard("7+"));
+    defenderGame.makeTurn(parseCard("A+"));
+    defenderGame.makeTurn(parseCard("8+"));
+    REQUIRE(defenderGame.getActivePlayer() == 1);
+    defenderGame.getTargetScoreBounds(iLower, iUpper);
+    REQUIRE(iLower == 0);
+    REQUIRE(iUpper == 0);
+
+    // Players with their own goals are searched with max-n
+    CGameState threeWayGame(CPlayer("7^ 9+ Q$", PS_P1MAX), CPlayer("9^ 7+ K$", PS_P2MAX), CPlayer("K^ J+ 7$", PS_P3MAX));
+    REQUIRE(threeWayGame.isZeroSumGame() == false);
+    REQUIRE_THROWS(threeWayGame.getTargetScoreBounds(iLower, iUpper));
+    REQUIRE(getObjStr(threeWayGame.playGameRecursive().getOptimalScore()) == "(0, 1, 2)");
+}
+
+TEST_CASE("Claims", "Game State")
+{
+    // Top cards win all the tricks, even if the player does not want them
+    CScore score;
+    CGameState topCardsGame(CPlayer("A^ K^ A+", PS_P1MIN), CPlayer("7^ 8^ 7+", PS_P2MAX), CPlayer("9^ 1^ 8+", PS_P3MAX));
+    topCardsGame.setTrumpSuit(CS_UNKNOWN);
+    REQUIRE(topCardsGame.checkClaim(score) == true);
+    REQUIRE(getObjStr(score) == "(3, 0, 0)");
+    REQUIRE(getObjStr(topCardsGame.playGameRecursive().getOptimalScore()) == "(3, 0, 0)");
+
+    // Claims are checked at the start of a trick only
+    topCardsGame.makeTurn(parseCard("A+"));
+    REQUIRE(topCardsGame.checkClaim(score) == false);
+
+    // Other players' trumps are drawn, if the player wants tricks
+    CGameState trumpsGame(CPlayer("A^ A+ K+", PS_P1MAX), CPlayer("7^ 7+ 8+", PS_P1MIN), CPlayer("9+ 1+ J+", PS_P1MIN));
+    trumpsGame.setTrumpSuit(CS_SPIDES);
+    REQUIRE(trumpsGame.checkClaim(score) == true);
+    REQUIRE(getObjStr(score) == "(3, 0, 0)");
+
+    CGameState misereGame(CPlayer("A^ A+ K+", PS_P1MIN), CPlayer("7^ 7+ 8+", PS_P1MAX), CPlayer("9+ 1+ J+", PS_P1MAX));
+    misereGame.setTrumpSuit(CS_SPIDES);
+    REQUIRE(misereGame.checkClaim(score) == false);
+
+    // No claims with a higher card, or more trumps in other hands
+    CGameState higherCardGame(CPlayer("A^ K+ Q+", PS_P1MAX), CPlayer("7^ A+ 7+", PS_P1MIN), CPlayer("8^ 9+ 1+", PS_P1MIN));
+    higherCardGame.setTrumpSuit(CS_SPIDES);
+    REQUIRE(higherCardGame.checkClaim(score) == false);
+
+    CGameState moreTrumpsGame(CPlayer("A^ A+ K+", PS_P1MAX), CPlayer("7^ 8^ 7+", PS_P1MIN), CPlayer("9+ 1+ J+", PS_P1MIN));
+    moreTrumpsGame.setTrumpSuit(CS_SPIDES);
+    REQUIRE(moreTrumpsGame.checkClaim(score) == false);
+}
+
+TEST_CASE("Move ordering", "Move Ordering")
+{
+    CGameState game(CPlayer("7^ 8^ A^ 7+", PS_P1MAX), CPlayer("9^ 1^ J^ 8+", PS_P1MIN), CPlayer("Q^ K^ 9+ 1+", PS_P1MIN));
+    game.setTrumpSuit(CS_UNKNOWN);
+
+    // The declarer cashes the ace first
+    Card aTurns[MAX_CARDS];
+    CMoveOrdering ordering;
+    CardMask turns = CCardPack("7^ 8^ A^ 7+").getCardsMask();
+    REQUIRE(ordering.orderTurns(game, turns, UNKNOWN_CARD, aTurns) == 4);
+    REQUIRE(aTurns[0] == MAKE_CARD(CS_SPIDES, CV_ACE));
+
+    // The hash turn goes first anyway
+    REQUIRE(ordering.orderTurns(game, turns, MAKE_CARD(CS_CLUBS, CV_7), aTurns) == 4);
+    REQUIRE(aTurns[0] == MAKE_CARD(CS_CLUBS, CV_7));
+    REQUIRE(aTurns[1] == MAKE_CARD(CS_SPIDES, CV_ACE));
+
+    // A defender cannot beat the ace, and keeps higher cards
+    game.makeTurn(MAKE_CARD(CS_SPIDES, CV_ACE));
+    turns = CCardPack("9^ 1^ J^").getCardsMask();
+    REQUIRE(ordering.orderTurns(game, turns, UNKNOWN_CARD, aTurns) == 3);
+    REQUIRE(aTurns[0] == MAKE_CARD(CS_SPIDES, CV_9));
 }
 
 TEST_CASE("Game path functions", "Game Path")
@@ -453,32 +808,439 @@ TEST_CASE("Visited State Cache", "Visited State Cache")
     CGameState anotherState(player3, player2, player1);
     state.setScore(CScore(3, 2, 1));
 
-    // Create a path
-    CPath path(CScore(1, 2, 3));
-    CPath anotherPath(CScore(3, 2, 1));
-
     // Add the state to the cache
-    cache.addVisitedState(state, path);
+    cache.addVisitedState(state, CScore(4, 2, 1), parseCard("7^"));
     REQUIRE(cache.getCacheSize() == 1);
 
     // Check the state is there
-    CPath retpath1 = cache.getVisitedState(state);
-    REQUIRE(retpath1.isValid() == true);
-    REQUIRE(getObjStr(retpath1.getOptimalScore()) == "(1, 2, 3)");
+    CScore score;
+    Card turn;
+    REQUIRE(cache.getVisitedState(state, score, turn) == true);
+    REQUIRE(getObjStr(score) == "(4, 2, 1)");
+    REQUIRE(getCardStr(turn) == "7^");
     REQUIRE(cache.getHitsCount() == 1);
 
     // Check if other state is not yet there
-    CPath retpath2 = cache.getVisitedState(anotherState);
-    REQUIRE(retpath2.isValid() == false);
+    REQUIRE(cache.getVisitedState(anotherState, score, turn) == false);
     REQUIRE(cache.getCacheSize() == 1);
 
     // Add another state
-    cache.addVisitedState(anotherState, anotherPath);
+    cache.addVisitedState(anotherState, CScore(1, 1, 1), parseCard("K^"));
     REQUIRE(cache.getCacheSize() == 2);
 
     // Check if the new state is now there
-    CPath retpath3 = cache.getVisitedState(anotherState);
-    REQUIRE(retpath3.isValid() == true);
+    REQUIRE(cache.getVisitedState(anotherState, score, turn) == true);
+    REQUIRE(getCardStr(turn) == "K^");
     REQUIRE(cache.getCacheSize() == 2);
     REQUIRE(cache.getHitsCount() == 2);
+
+    // The same state with a different score shares the entry, cached entry holds the score
+    // of the remaining tricks, and the state score is added to it
+    CVisitedStateCache cache2;
+    CGameState state2(player1, player2, player3);
+    state2.setScore(CScore(1, 0, 0));
+    cache2.addVisitedState(state2, CScore(2, 1, 0), parseCard("Q$"));
+
+    CGameState state3(player1, player2, player3);
+    state3.setScore(CScore(0, 1, 0));
+    REQUIRE(cache2.getVisitedState(state3, score, turn) == true);
+    REQUIRE(getObjStr(score) == "(1, 2, 0)");
+    REQUIRE(cache2.getCacheSize() == 1);
+
+    // States that differ by side suits permutation share the entry, and the turn gets
+    // the suit of the requested state
+    CVisitedStateCache cache3(1);
+    for(unsigned int i = 0; i < CVisitedStateCache::PARTITIONS_COUNT; i++)
+    {
+        cache3.setPartitionSize(i, 64);
+        cache3.setPartitionEnabled(i, true);
+    }
+
+    CGameState game1(player1, player2, player3);
+    game1.setVisitedStatesCache(&cache3);
+    CPath solution = game1.playGameRecursive();
+    REQUIRE(solution.getTurnsCount() == 9);
+
+    CGameState game2(CPlayer("7@ 9+ Q$", PS_P2MIN), CPlayer("9@ 7+ K$", PS_P2MAX), CPlayer("K@ J+ 7$", PS_P2MIN));
+    REQUIRE(cache3.getVisitedState(game2, score, turn) == true);
+    REQUIRE(score == solution.getOptimalScore());
+
+    Card expectedTurn = solution.getTurn(0);
+    if(getSuit(expectedTurn) == CS_SPIDES)
+        expectedTurn = MAKE_CARD(CS_HEARTS, getCardValue(expectedTurn));
+    REQUIRE(turn == expectedTurn);
+
+    // States with the same relative order of cards share the entry, and the turn gets
+    // the card of the requested state
+    CGameState game3(CPlayer("8^ 1+ K$", PS_P2MIN), CPlayer("1^ 8+ A$", PS_P2MAX), CPlayer("A^ Q+ 8$", PS_P2MIN));
+    REQUIRE(cache3.getVisitedState(game3, score, turn) == true);
+    REQUIRE(score == solution.getOptimalScore());
+    REQUIRE(turn == game3.playGameRecursive().getTurn(0));
+
+    // The whole path of a similar state is made of cached entries, no states are searched
+    auto getStoresCount = [](const CVisitedStateCache & cache)
+    {
+        size_t iStores = 0;
+        for(unsigned int i = 0; i < CVisitedStateCache::PARTITIONS_COUNT; i++)
+            iStores += cache.getPartitionStats(i).m_iStores;
+        return iStores;
+    };
+
+    game3.setVisitedStatesCache(&cache3);
+    size_t iHits = cache3.getHitsCount();
+    size_t iStores = getStoresCount(cache3);
+    CPath path3 = game3.playGameRecursive();
+    REQUIRE(path3.getTurnsCount() == 9);
+    REQUIRE(cache3.getHitsCount() > iHits);
+    REQUIRE(getStoresCount(cache3) == iStores);
+
+    // A cache of single bucket partitions evicts states, but the search result is the same
+    CVisitedStateCache smallCache(0);
+    REQUIRE(smallCache.getCapacity() == 3 * CVisitedStateCache::PARTITIONS_COUNT);
+    CGameState game4(player1, player2, player3);
+    game4.setVisitedStatesCache(&smallCache);
+    CPath solution2 = game4.playGameRecursive();
+    REQUIRE(solution2.getOptimalScore() == solution.getOptimalScore());
+    REQUIRE(solution2.getOptimalPath() == solution.getOptimalPath());
+    REQUIRE(smallCache.getCacheSize() < cache3.getCacheSize());
+
+    // Entries of previous searches are still used
+    smallCache.newSearch();
+    REQUIRE(game4.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+
+    // Entries of previous searches are replaced first, however many searches ago they were stored
+    {
+        CVisitedStateCache agingCache(0);
+        CGameState aStates[] = {
+            CGameState(CPlayer("7^ 8^", PS_P1MAX), CPlayer("9^ 1^", PS_P1MIN), CPlayer("J^ Q^", PS_P1MIN)),
+            CGameState(CPlayer("7^ 7+", PS_P1MAX), CPlayer("8^ 8+", PS_P1MIN), CPlayer("9^ 9+", PS_P1MIN)),
+            CGameState(CPlayer("7^ 8^", PS_P1MAX), CPlayer("9^ 7+", PS_P1MIN), CPlayer("1^ 8+", PS_P1MIN)),
+            CGameState(CPlayer("7^ 7+", PS_P1MAX), CPlayer("8^ 9^", PS_P1MIN), CPlayer("8+ 9+", PS_P1MIN))
+        };
+
+        CScore score;
+        Card turn;
+        for(unsigned int i = 0; i < 3; i++)
+            agingCache.addVisitedState(aStates[i], CScore(), parseCard("7^"));
+
+        for(unsigned int i = 0; i < 16; i++)
+            agingCache.newSearch();
+
+        agingCache.addVisitedState(aStates[0], CScore(), parseCard("7^"));
+        agingCache.addVisitedState(aStates[1], CScore(), parseCard("7^"));
+        agingCache.addVisitedState(aStates[3], CScore(), parseCard("7^"));
+        REQUIRE(agingCache.getVisitedState(aStates[0], score, turn) == true);
+        REQUIRE(agingCache.getVisitedState(aStates[1], score, turn) == true);
+        REQUIRE(agingCache.getVisitedState(aStates[2], score, turn) == false);
+        REQUIRE(agingCache.getVisitedState(aStates[3], score, turn) == true);
+    }
+
+    // By default only trick starts are cached, except for the last trick
+    CVisitedStateCache partialCache(1);
+    CGameState game5(player1, player2, player3);
+    game5.setVisitedStatesCache(&partialCache);
+    REQUIRE(game5.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+
+    const CachePartitionStats & stats1 = partialCache.getPartitionStats(CVisitedStateCache::getPartitionIdx(2, 0));
+    const CachePartitionStats & stats2 = partialCache.getPartitionStats(CVisitedStateCache::getPartitionIdx(2, 1));
+    REQUIRE(stats1.m_iStores > 0);
+    REQUIRE(stats1.m_iSize > 0);
+    REQUIRE(stats1.m_iHits + stats1.m_iMisses > 0);
+    REQUIRE(stats2.m_iStores == 0);
+    REQUIRE(stats2.m_iHits + stats2.m_iMisses == 0);
+    REQUIRE(partialCache.getPartitionStats(CVisitedStateCache::getPartitionIdx(1, 0)).m_iStores == 0);
+    REQUIRE_THROWS(CVisitedStateCache::getPartitionIdx(HAND_SIZE + 1, 0));
+
+    // Save the cache, and attach it to a new cache
+    const char * fileName = "VisitedStateCache.test.bin";
+    cache3.saveToFile(fileName);
+    {
+        CVisitedStateCache fileCache(1);
+        fileCache.attachFile(fileName);
+
+        CGameState game6(player1, player2, player3);
+        game6.setVisitedStatesCache(&fileCache);
+        REQUIRE(game6.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+        REQUIRE(fileCache.getHitsCount() > 0);
+        REQUIRE(fileCache.getCacheSize() == 0);
+
+        // The attached file can be replaced with the updated one
+        fileCache.saveToFile(fileName);
+        CVisitedStateCache fileCache3(1);
+        fileCache3.attachFile(fileName);
+        REQUIRE(fileCache3.getVisitedState(game6, score, turn) == true);
+        REQUIRE(fileCache.getVisitedState(game6, score, turn) == true);
+
+        // States of the file are not used for the same cards with different strategies
+        CPlayer misereDeclarer("9^ 7+ K$", PS_P2MIN);
+        CPlayer misereDefender("K^ J+ 7$", PS_P2MAX);
+        CGameState misereGame(player1, misereDeclarer, misereDefender);
+        CPath misereSolution = CGameState(player1, misereDeclarer, misereDefender).playGameRecursive();
+        REQUIRE(fileCache3.getVisitedState(misereGame, score, turn) == false);
+
+        misereGame.setVisitedStatesCache(&fileCache3);
+        REQUIRE(misereGame.playGameRecursive().getOptimalPath() == misereSolution.getOptimalPath());
+
+        // Detached file states are not used any more
+        fileCache.detachFile();
+        REQUIRE(fileCache.getVisitedState(game6, score, turn) == false);
+    }
+
+    // Not a cache file
+    std::ofstream(fileName, std::ios::trunc) << "Not a cache file";
+    CVisitedStateCache fileCache2(1);
+    REQUIRE_THROWS(fileCache2.attachFile(fileName));
+    std::remove(fileName);
+    REQUIRE_THROWS(fileCache2.attachFile(fileName));
+
+    // Caches in the same shared memory segment use states of each other
+    const char * segmentName = "/PreferansSolver.test";
+    CSharedVisitedStateCache::removeSharedCache(segmentName);
+    {
+        CSharedVisitedStateCache sharedCache(segmentName, 1);
+        CGameState game7(player1, player2, player3);
+        game7.setVisitedStatesCache(&sharedCache);
+        REQUIRE(game7.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+        REQUIRE(sharedCache.getCacheSize() > 0);
+
+        // Size of the existing segment is used
+        CSharedVisitedStateCache sharedCache2(segmentName, 2);
+        REQUIRE(sharedCache2.getCapacity() == sharedCache.getCapacity());
+        REQUIRE(sharedCache2.getCacheSize() == sharedCache.getCacheSize());
+        REQUIRE(sharedCache2.getVisitedState(game7, score, turn) == true);
+
+        // States of games with different strategies are not shared
+        CGameState misereGame(player1, CPlayer("9^ 7+ K$", PS_P2MIN), CPlayer("K^ J+ 7$", PS_P2MAX));
+        REQUIRE(sharedCache2.getVisitedState(misereGame, score, turn) == false);
+
+        CGameState game8(player1, player2, player3);
+        game8.setVisitedStatesCache(&sharedCache2);
+        REQUIRE(game8.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+        REQUIRE(sharedCache2.getPartitionStats(CVisitedStateCache::getPartitionIdx(HAND_SIZE, 0)).m_iStores == 0);
+
+        // Shared partitions are not moved to the private memory
+        CVisitedStateCache & baseCache = sharedCache2;
+        REQUIRE_THROWS(baseCache.setPartitionSize(CVisitedStateCache::getPartitionIdx(HAND_SIZE, 0), 64));
+        REQUIRE(sharedCache2.getVisitedState(game7, score, turn) == true);
+    }
+    REQUIRE(CSharedVisitedStateCache::removeSharedCache(segmentName) == true);
+    REQUIRE(CSharedVisitedStateCache::removeSharedCache(segmentName) == false);
+
+    // A segment, that the creator has not initialized, is created once more
+    int fd = shm_open(segmentName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    REQUIRE(fd >= 0);
+    REQUIRE(ftruncate(fd, 4096) == 0);
+    close(fd);
+    {
+        CSharedVisitedStateCache sharedCache(segmentName, 1);
+        CGameState game9(player1, player2, player3);
+        game9.setVisitedStatesCache(&sharedCache);
+        REQUIRE(game9.playGameRecursive().getOptimalPath() == solution.getOptimalPath());
+
+        // The segment is accessible by the owner only
+        fd = shm_open(segmentName, O_RDONLY, 0);
+        struct stat segmentStat;
+        REQUIRE(fstat(fd, &segmentStat) == 0);
+        REQUIRE((segmentStat.st_mode & 0777) == 0600);
+        close(fd);
+    }
+    REQUIRE(CSharedVisitedStateCache::removeSharedCache(segmentName) == true);
+}
+
+TEST_CASE("Deal parser", "Deal")
+{
+    SECTION("Parse a single deal")
+    {
+        const char * line = "J^ Q^   7+ 9+   1$ J$ Q$ K$   7@ J@ | 7^ 8^ 9^ 1^   8+   7$ 8$ 9$   8@ 9@ |"
+                            "K^ A^   1+ J+ Q+   A$   1@ Q@ K@ A@ | K+ A+";
+        Deal deal;
+        REQUIRE(CDealParser::parseDeal(line, strlen(line), deal) == DPS_OK);
+        REQUIRE(deal.m_aHands[0] == CCardPack("J^ Q^ 7+ 9+ 1$ J$ Q$ K$ 7@ J@").getCardsMask());
+        REQUIRE(deal.m_aHands[1] == CCardPack("7^ 8^ 9^ 1^ 8+ 7$ 8$ 9$ 8@ 9@").getCardsMask());
+        REQUIRE(deal.m_aHands[2] == CCardPack("K^ A^ 1+ J+ Q+ A$ 1@ Q@ K@ A@").getCardsMask());
+        REQUIRE(deal.m_talon == CCardPack("K+ A+").getCardsMask());
+        REQUIRE(deal.isComplete());
+
+        // Printed deal can be parsed back
+        std::string dealStr = deal.getDealStr();
+        Deal deal2;
+        REQUIRE(CDealParser::parseDeal(dealStr.c_str(), dealStr.size(), deal2) == DPS_OK);
+        REQUIRE(deal == deal2);
+    }
+
+    SECTION("Parse errors")
+    {
+        Deal deal;
+        const char * line1 = "7^ 8^ | 9^ | 1^ J^ | Q^ | K^";
+        REQUIRE(CDealParser::parseDeal(line1, strlen(line1), deal) == DPS_BAD_HANDS_COUNT);
+        const char * line2 = "7^ 8^ | 9^";
+        REQUIRE(CDealParser::parseDeal(line2, strlen(line2), deal) == DPS_BAD_HANDS_COUNT);
+        const char * line3 = "7^ 8^ | 9^ | 7^";
+        REQUIRE(CDealParser::parseDeal(line3, strlen(line3), deal) == DPS_DUPLICATE_CARD);
+        const char * line4 = "7^ 8^ | 9^ | 6^";
+        REQUIRE(CDealParser::parseDeal(line4, strlen(line4), deal) == DPS_NOT_PREFERANS_CARD);
+        const char * line5 = "7^ 8^ | 9^ | ??";
+        REQUIRE(CDealParser::parseDeal(line5, strlen(line5), deal) == DPS_NOT_PREFERANS_CARD);
+        const char * line6 = "7^ 8^ | 9^ | Z^";
+        REQUIRE(CDealParser::parseDeal(line6, strlen(line6), deal) == DPS_BAD_CARD);
+        const char * line7 = "7^ 8^ | 9^ | 7";
+        REQUIRE(CDealParser::parseDeal(line7, strlen(line7), deal) == DPS_BAD_CARD);
+    }
+
+    SECTION("Parse a buffer")
+    {
+        std::string buf = "# Comment line\n"
+                          "7^ 8^ | 9^ 1^ | J^ Q^\r\n"
+                          "\n"
+                          "7^ 8^ | 9^ 1^ | J^ 7^\n"
+                          "7+ 8+ | 9+ 1+ | J+ Q+ | K+ A+";
+
+        CDealParser parser;
+        std::vector<Deal> deals;
+        REQUIRE(parser.parseDeals(buf.c_str(), buf.size(), deals) == 2);
+        REQUIRE(deals.size() == 2);
+        REQUIRE(deals[0].m_aHands[2] == CCardPack("J^ Q^").getCardsMask());
+        REQUIRE(deals[1].m_talon == CCardPack("K+ A+").getCardsMask());
+
+        REQUIRE(parser.getErrors().size() == 1);
+        REQUIRE(parser.getErrors()[0].m_iLine == 4);
+        REQUIRE(parser.getErrors()[0].m_status == DPS_DUPLICATE_CARD);
+    }
+}
+
+TEST_CASE("Deal generator", "Deal")
+{
+    SECTION("Random numbers generator")
+    {
+        // Generator is reproducible
+        CRandomGenerator random1(1);
+        CRandomGenerator random2(1);
+        for(unsigned int i = 0; i < 100; i++)
+            REQUIRE(random1.next() == random2.next());
+
+        // Streams are made with jumps
+        CRandomGenerator random3(1, 2);
+        CRandomGenerator random4(1);
+        random4.jump();
+        random4.jump();
+        REQUIRE(random3.next() == random4.next());
+
+        // Bounded numbers are within the range
+        for(unsigned int range = 1; range <= MAX_CARDS; range++)
+            for(unsigned int i = 0; i < 100; i++)
+                REQUIRE(random1.getBounded(range) < range);
+    }
+
+    SECTION("Generated deals")
+    {
+        CDealGenerator generator(12345);
+        std::vector<Deal> deals;
+        generator.generateDeals(1000, deals);
+        REQUIRE(deals.size() == 1000);
+
+        // Every card goes to every place of the deal
+        unsigned int aCardCounts[MAX_PLAYERS + 1][MAX_CARDS] = {};
+        for(const Deal & deal : deals)
+        {
+            REQUIRE(deal.isComplete());
+
+            for(unsigned int i = 0; i < MAX_CARDS; i++)
+            {
+                aCardCounts[0][i] += (deal.m_aHands[0] >> i) & 1;
+                aCardCounts[1][i] += (deal.m_aHands[1] >> i) & 1;
+                aCardCounts[2][i] += (deal.m_aHands[2] >> i) & 1;
+                aCardCounts[MAX_PLAYERS][i] += (deal.m_talon >> i) & 1;
+            }
+        }
+
+        for(unsigned int i = 0; i < MAX_CARDS; i++)
+        {
+            REQUIRE(aCardCounts[0][i] > 0);
+            REQUIRE(aCardCounts[1][i] > 0);
+            REQUIRE(aCardCounts[2][i] > 0);
+            REQUIRE(aCardCounts[MAX_PLAYERS][i] > 0);
+        }
+
+        // Generator with the same seed and stream makes the same deals
+        CDealGenerator generator2(12345);
+        std::vector<Deal> deals2;
+        generator2.generateDeals(1000, deals2);
+        REQUIRE(deals == deals2);
+
+        // Another stream makes different deals
+        CDealGenerator generator3(12345, 1);
+        std::vector<Deal> deals3;
+        generator3.generateDeals(1000, deals3);
+        REQUIRE(deals != deals3);
+    }
+}
+
+TEST_CASE("Deal ranker", "Deal")
+{
+    SECTION("Complete deals")
+    {
+        CDealRanker ranker;
+
+        // C(32, 10) * C(22, 10) * C(12, 10)
+        REQUIRE(ranker.getDealsCount() == 64512240ull * 646646ull * 66ull);
+
+        // Boundary ranks
+        Deal deal;
+        ranker.unrankDeal(0, deal);
+        REQUIRE(deal.isComplete());
+        REQUIRE(ranker.rankDeal(deal) == 0);
+        ranker.unrankDeal(ranker.getDealsCount() - 1, deal);
+        REQUIRE(deal.isComplete());
+        REQUIRE(ranker.rankDeal(deal) == ranker.getDealsCount() - 1);
+
+        // Random deals are restored from their ranks
+        CDealGenerator generator(777);
+        for(unsigned int i = 0; i < 1000; i++)
+        {
+            generator.generateDeal(deal);
+            DealRank rank = ranker.rankDeal(deal);
+            REQUIRE(rank < ranker.getDealsCount());
+
+            Deal deal2;
+            ranker.unrankDeal(rank, deal2);
+            REQUIRE(deal2 == deal);
+        }
+    }
+
+    SECTION("Deals with known cards")
+    {
+        // 3 unknown cards: 9+ 1+ A+, one goes to the 1st player, and two go to the 3rd one
+        Deal known;
+        const char * line = "7^ 8^ 9^ 1^ J^ Q^ K^ A^ 7+ | 8+ 7$ 8$ 9$ 1$ J$ Q$ K$ A$ 7@ | 8@ 9@ 1@ J@ Q@ K@ A@ J+ | Q+ K+";
+        REQUIRE(CDealParser::parseDeal(line, strlen(line), known) == DPS_OK);
+
+        CDealRanker ranker(known);
+        REQUIRE(ranker.getDealsCount() == 3);
+
+        // Enumerate all deals
+        std::vector<Deal> deals;
+        for(DealRank rank = 0; rank < ranker.getDealsCount(); rank++)
+        {
+            Deal deal;
+            ranker.unrankDeal(rank, deal);
+            REQUIRE(deal.isComplete());
+            REQUIRE(ranker.rankDeal(deal) == rank);
+            for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+                REQUIRE((deal.m_aHands[i] & known.m_aHands[i]) == known.m_aHands[i]);
+            REQUIRE(deal.m_talon == known.m_talon);
+
+            for(const Deal & prevDeal : deals)
+                REQUIRE_FALSE(prevDeal == deal);
+            deals.push_back(deal);
+        }
+
+        // Only one hand is known
+        Deal known2{{CCardPack("7^ 8^ 9^ 1^ J^ Q^ K^ A^ 7+ 8+").getCardsMask(), 0, 0}, 0};
+        CDealRanker ranker2(known2);
+        REQUIRE(ranker2.getDealsCount() == 646646ull * 66ull);
+
+        // Known cards that do not fit a deal
+        Deal bad{{CCardPack("7^ 8^ 9^").getCardsMask(), 0, 0}, CCardPack("7@ 8@ 9@").getCardsMask()};
+        REQUIRE_THROWS(CDealRanker(bad));
+    }
 }
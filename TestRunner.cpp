@@ -1,3 +1,4 @@
 #define CATCH_CONFIG_MAIN
+// Bundled Catch2 uses MINSIGSTKSZ as a compile time constant, which is not the case for newer glibc
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
 #include <catch2/catch.hpp>
-
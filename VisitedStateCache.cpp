@@ -1,2 +1,621 @@
 #include "VisitedStateCache.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+/**
+ * @brief Calculate the suit signature
+ *
+ * Suits with equal signatures have the same cards in the same hands and on the same table
+ * slots, so they are interchangeable. Signature bits are:
+ * - bits 0-23: cards of the suit in each player's hand (8 bits per player)
+ * - bits 24-39: cards of the suit in each table slot (8 bits per slot)
+ * - bit 40: the suit is the current trick suit
+ * .
+ *
+ * @param state - the state
+ * @param suit  - the suit
+ *
+ * @return the suit signature
+ */
+inline uint64_t getSuitSignature(const GameStateData & state, CardSuit suit)
+{
+    uint64_t signature = 0;
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        signature |= uint64_t(getSuitMask(state.m_aHands[i], suit)) << (i * CARDS_IN_SUIT);
+
+    for(unsigned int i = 0; i < state.m_iCardsOnTableCount; i++)
+        if(getSuit(state.m_aCardsOnTable[i]) == suit)
+            signature |= uint64_t(getSuitMask(getCardBit(state.m_aCardsOnTable[i]), suit)) << (24 + i * CARDS_IN_SUIT);
+
+    if(state.m_currentSuit == suit)
+        signature |= uint64_t(1) << 40;
+
+    return signature;
+}
+
+/**
+ * @brief Calculate the key hash
+ *
+ * The key is mixed with splitmix64 finalizer, so that all key bits affect the probe start
+ *
+ * @param key   - the key
+ *
+ * @return the key hash
+ */
+inline uint64_t getKeyHash(const GameStateKey & key)
+{
+    uint64_t z = key.m_aWords[0] ^ (key.m_aWords[1] * 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+CVisitedStateCache::CVisitedStateCache(size_t iSizeMB)
+    : CVisitedStateCache(iSizeMB, true)
+{
+}
+
+CVisitedStateCache::CVisitedStateCache(size_t iSizeMB, bool bAllocate)
+{
+#if !defined(_WIN32)
+    m_pFileData = nullptr;
+    m_iFileSize = 0;
+#endif
+
+    // States in the middle of the trick are rarely reused, and the last trick is cheaper
+    // to search than to probe, so only trick starts with 2 or more tricks left are cached
+    m_iGeneration = 0;
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+    {
+        CachePartition & partition = m_aPartitions[i];
+        partition.m_bEnabled = (i % MAX_PLAYERS == 0) && (i >= MAX_PLAYERS);
+        partition.m_pFileBuckets = nullptr;
+        partition.m_iFileBucketsCount = 0;
+
+        partition.m_pBuckets = nullptr;
+        partition.m_iBucketsCount = getBucketsCount(partition.m_bEnabled ? iSizeMB * 1024 / (HAND_SIZE - 1) : 0);
+        m_aStats[i] = CachePartitionStats{0, 0, 0, 0, 0};
+
+        if(bAllocate)
+        {
+            partition.m_storage.resize(partition.m_iBucketsCount);
+            setPartitionBuckets(i, partition.m_storage.data(), partition.m_iBucketsCount);
+        }
+    }
+}
+
+CVisitedStateCache::~CVisitedStateCache()
+{
+    detachFile();
+}
+
+unsigned int CVisitedStateCache::getPartitionIdx(unsigned int iTricksLeft, unsigned int iPosition)
+{
+    if(iTricksLeft < 1 || iTricksLeft > HAND_SIZE || iPosition >= MAX_PLAYERS)
+        throw "CVisitedStateCache::getPartitionIdx(): Partition parameters are out of bounds";
+
+    return (iTricksLeft - 1) * MAX_PLAYERS + iPosition;
+}
+
+void CVisitedStateCache::setPartitionSize(unsigned int iPartition, size_t iSizeKB)
+{
+    size_t iBucketsCount = getBucketsCount(iSizeKB);
+    std::vector<CacheBucket> buckets(iBucketsCount);
+    m_aPartitions[iPartition].m_storage.swap(buckets);
+    setPartitionBuckets(iPartition, m_aPartitions[iPartition].m_storage.data(), iBucketsCount);
+}
+
+size_t CVisitedStateCache::getBucketsCount(size_t iSizeKB)
+{
+    size_t iBucketsCount = 1;
+    while(iBucketsCount * 2 * sizeof(CacheBucket) <= iSizeKB * 1024)
+        iBucketsCount *= 2;
+
+    return iBucketsCount;
+}
+
+void CVisitedStateCache::setPartitionBuckets(unsigned int iPartition, CacheBucket * pBuckets, size_t iBucketsCount)
+{
+    CachePartition & partition = m_aPartitions[iPartition];
+    if(pBuckets != partition.m_storage.data())
+        std::vector<CacheBucket>().swap(partition.m_storage);
+
+    partition.m_pBuckets = pBuckets;
+    partition.m_iBucketsCount = iBucketsCount;
+
+    // Count states, that are already there
+    size_t iSize = 0;
+    for(size_t i = 0; i < iBucketsCount; i++)
+        for(unsigned int j = 0; j < BUCKET_ENTRIES; j++)
+            if(isEntryUsed(pBuckets[i].getData(j)))
+                iSize++;
+
+    m_aStats[iPartition] = CachePartitionStats{0, 0, 0, iSize, iBucketsCount * BUCKET_ENTRIES};
+}
+
+size_t CVisitedStateCache::getHitsCount() const
+{
+    size_t iHits = 0;
+    for(const CachePartitionStats & stats : m_aStats)
+        iHits += stats.m_iHits;
+
+    return iHits;
+}
+
+size_t CVisitedStateCache::getCacheSize() const
+{
+    size_t iSize = 0;
+    for(const CachePartitionStats & stats : m_aStats)
+        iSize += stats.m_iSize;
+
+    return iSize;
+}
+
+size_t CVisitedStateCache::getCapacity() const
+{
+    size_t iCapacity = 0;
+    for(const CachePartitionStats & stats : m_aStats)
+        iCapacity += stats.m_iCapacity;
+
+    return iCapacity;
+}
+
+void CVisitedStateCache::makeCanonicalKey(const GameStateData & state, GameStateKey & key, StateMapping & mapping)
+{
+    // Compress ranks: cards left of each suit are replaced with the lowest cards of the suit
+    GameStateData relative = state;
+    CardMask aNextBits[SUITS_COUNT];
+    for(unsigned int s = 0; s < SUITS_COUNT; s++)
+        aNextBits[s] = CardMask(1) << (s * CARDS_IN_SUIT);
+
+    relative.m_aHands[0] = relative.m_aHands[1] = relative.m_aHands[2] = 0;
+    for(CardMask cards = state.m_cardsLeft; cards != 0; cards &= cards - 1)
+    {
+        CardMask card = cards & (0 - cards);
+        CardMask & bit = aNextBits[getLowestCardIdx(card) / CARDS_IN_SUIT];
+        for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+            if(state.m_aHands[i] & card)
+                relative.m_aHands[i] |= bit;
+
+        bit <<= 1;
+    }
+
+    for(unsigned int i = 0; i < state.m_iCardsOnTableCount; i++)
+    {
+        Card card = state.m_aCardsOnTable[i];
+        CardMask lower = state.m_cardsLeft & getSuitCardsMask(getSuit(card)) & (getCardBit(card) - 1);
+        relative.m_aCardsOnTable[i] = MAKE_CARD(getSuit(card), CV_7 + countCards(lower));
+    }
+
+    // Sort suits by their signatures (simple insertion sort for 4 suits). The trump suit
+    // is not interchangeable with other suits, it stays at its place
+    unsigned int trumpIdx = getSuitIdx(static_cast<CardSuit>(state.m_trumpSuit));
+    unsigned int aSuits[SUITS_COUNT];
+    uint64_t aSignatures[SUITS_COUNT];
+    unsigned int iCount = 0;
+    for(unsigned int s = 0; s < SUITS_COUNT; s++)
+    {
+        if(s == trumpIdx)
+            continue;
+
+        uint64_t signature = getSuitSignature(relative, static_cast<CardSuit>(s << 4));
+        unsigned int i = iCount++;
+        for(; i > 0 && aSignatures[i - 1] < signature; i--)
+        {
+            aSuits[i] = aSuits[i - 1];
+            aSignatures[i] = aSignatures[i - 1];
+        }
+
+        aSuits[i] = s;
+        aSignatures[i] = signature;
+    }
+
+    // Sorted suits take places of the side suits in the ascending order
+    unsigned int iPos = 0;
+    for(unsigned int s = 0; s < SUITS_COUNT; s++)
+    {
+        unsigned int origSuit = (s == trumpIdx) ? s : aSuits[iPos++];
+        mapping.m_aToCanonical[origSuit] = static_cast<CardSuit>(s << 4);
+        mapping.m_aFromCanonical[s] = static_cast<CardSuit>(origSuit << 4);
+    }
+
+    mapping.m_cardsLeft = state.m_cardsLeft;
+
+    // Relabel suits of the state
+    GameStateData canonical = relative;
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+    {
+        canonical.m_aHands[i] = 0;
+        for(unsigned int s = 0; s < SUITS_COUNT; s++)
+            canonical.m_aHands[i] |= makeCardMask(getSuitMask(relative.m_aHands[i], mapping.m_aFromCanonical[s]),
+                                                  static_cast<CardSuit>(s << 4));
+    }
+
+    for(unsigned int i = 0; i < state.m_iCardsOnTableCount; i++)
+    {
+        Card card = relative.m_aCardsOnTable[i];
+        canonical.m_aCardsOnTable[i] = MAKE_CARD(mapping.m_aToCanonical[getSuitIdx(getSuit(card))], getCardValue(card));
+    }
+
+    if(state.m_currentSuit != CS_UNKNOWN)
+        canonical.m_currentSuit = mapping.m_aToCanonical[getSuitIdx(static_cast<CardSuit>(state.m_currentSuit))];
+
+    canonical.pack(key);
+}
+
+void CVisitedStateCache::makeStateKey(const CGameState & state, GameStateKey & key, StateMapping & mapping)
+{
+    makeCanonicalKey(state.getStateData(), key, mapping);
+
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        key.m_aWords[1] |= uint64_t(state.getPlayerStrategy(i)) << (KEY_STRATEGIES_SHIFT + i * 3);
+}
+
+Card CVisitedStateCache::getCanonicalCard(const StateMapping & mapping, Card card)
+{
+    // Card rank is the number of lower cards of the suit left
+    CardMask lower = mapping.m_cardsLeft & getSuitCardsMask(getSuit(card)) & (getCardBit(card) - 1);
+    return MAKE_CARD(mapping.m_aToCanonical[getSuitIdx(getSuit(card))], CV_7 + countCards(lower));
+}
+
+Card CVisitedStateCache::getStateCard(const StateMapping & mapping, Card card)
+{
+    // Skip lower cards of the suit left according to the card rank
+    CardSuit suit = mapping.m_aFromCanonical[getSuitIdx(getSuit(card))];
+    CardMask cards = mapping.m_cardsLeft & getSuitCardsMask(suit);
+    for(unsigned int i = CV_7; i < getCardValue(card); i++)
+        cards &= cards - 1;
+
+    return getCardByIdx(getLowestCardIdx(cards));
+}
+
+size_t CVisitedStateCache::getBucketIdx(const GameStateKey & key, size_t iBucketsCount)
+{
+    return static_cast<size_t>(getKeyHash(key)) & (iBucketsCount - 1);
+}
+
+bool CVisitedStateCache::findEntry(const CacheBucket & bucket, const GameStateKey & key, uint32_t & data)
+{
+    for(unsigned int i = 0; i < BUCKET_ENTRIES; i++)
+    {
+        // Read the data once, so that the key is checked against the same data
+        uint32_t entryData = bucket.getData(i);
+        if(isEntryUsed(entryData) && lockKey(bucket.getLockedKey(i), entryData) == key)
+        {
+            data = entryData;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void CVisitedStateCache::addVisitedState(const CGameState & state, const CScore & score, Card bestTurn, ScoreBound bound)
+{
+    const GameStateData & data = state.getStateData();
+    unsigned int iPartition = getStatePartitionIdx(data);
+    if(iPartition >= PARTITIONS_COUNT || !m_aPartitions[iPartition].m_bEnabled)
+        return;
+
+    CachePartition & partition = m_aPartitions[iPartition];
+
+    GameStateKey key;
+    StateMapping mapping;
+    makeStateKey(state, key, mapping);
+
+    CachePartitionStats & stats = m_aStats[iPartition];
+    stats.m_iStores++;
+
+    CacheBucket & bucket = partition.m_pBuckets[getBucketIdx(key, partition.m_iBucketsCount)];
+
+    // Select the entry: an empty one or the one with the same state, otherwise the first one
+    // of previous searches. States of the partition are of the same depth, so only the search
+    // generation tells how valuable the entry is
+    unsigned int iEntry = 0;
+    unsigned int iEntryValue = ~0u;
+    for(unsigned int i = 0; i < BUCKET_ENTRIES; i++)
+    {
+        uint32_t entryData = bucket.getData(i);
+        if(!isEntryUsed(entryData) || lockKey(bucket.getLockedKey(i), entryData) == key)
+        {
+            iEntry = i;
+            break;
+        }
+
+        unsigned int iValue = ((entryData >> ENTRY_GENERATION_SHIFT) & 0xff) == m_iGeneration ? 1 : 0;
+
+        if(iValue < iEntryValue)
+        {
+            iEntry = i;
+            iEntryValue = iValue;
+        }
+    }
+
+    uint32_t oldData = bucket.getData(iEntry);
+    bool bSameState = isEntryUsed(oldData) && lockKey(bucket.getLockedKey(iEntry), oldData) == key;
+    if(!isEntryUsed(oldData))
+        stats.m_iSize++;
+
+    // Pack the score of remaining tricks and the canonical turn
+    CScore remaining = score;
+    remaining -= data.m_score;
+    uint32_t scoreBits = 0;
+    for(unsigned int i = 0; i < MAX_PLAYERS; i++)
+        scoreBits |= static_cast<uint32_t>(remaining.getPlayerScore(i)) << (i * 4);
+
+    uint32_t turnBits = getCardIdx(getCanonicalCard(mapping, bestTurn)) << ENTRY_TURN_SHIFT;
+    uint32_t upperBits = 0;
+
+    // In zero sum games the new bound is merged with the bounds, that are already known.
+    // The lower bound is the target player's part of the score, the upper one has its own field
+    unsigned int iTarget = state.getTargetPlayer();
+    if(iTarget < MAX_PLAYERS)
+    {
+        unsigned int iValue = remaining.getPlayerScore(iTarget);
+        uint32_t targetMask = 0x0fu << (iTarget * 4);
+        uint32_t oldScoreBits = bSameState ? (oldData & 0xfff) : (scoreBits & ~targetMask);
+        unsigned int iOldLower = (oldScoreBits & targetMask) >> (iTarget * 4);
+        unsigned int iUpper = bSameState ? (oldData >> ENTRY_UPPER_SHIFT) & 0x0f : countCards(data.m_cardsLeft) / MAX_PLAYERS;
+
+        // Bounds of the same state agree, as strategies are a part of the key. A contradicting
+        // old bound is still dropped, so that the entry never gets an empty window
+        if(bound == SB_EXACT)
+            iUpper = iValue;
+        else if(bound == SB_LOWER)
+        {
+            if(iUpper < iValue)
+                iUpper = countCards(data.m_cardsLeft) / MAX_PLAYERS;
+            if(iValue < iOldLower)
+                scoreBits = oldScoreBits;
+        }
+        else
+        {
+            if(iValue < iOldLower)
+                oldScoreBits &= ~targetMask;
+            scoreBits = oldScoreBits;
+            iUpper = std::min(iUpper, iValue);
+        }
+
+        // The turn is of the bound, that the active player proves, e.g. the lower one for
+        // the player, that maximizes the score. Turns of the other bound are just the first ones
+        ScoreBound turnBound = isMaxStrategy(state.getActivePlayerStrategy()) ? SB_LOWER : SB_UPPER;
+        if(bSameState && bound != SB_EXACT && bound != turnBound)
+            turnBits = oldData & (0x1fu << ENTRY_TURN_SHIFT);
+
+        upperBits = iUpper << ENTRY_UPPER_SHIFT;
+    }
+
+    uint32_t entryData = scoreBits | turnBits | upperBits;
+    entryData |= 1u << ENTRY_USED_SHIFT;
+    entryData |= static_cast<uint32_t>(m_iGeneration) << ENTRY_GENERATION_SHIFT;
+
+    bucket.setEntry(iEntry, lockKey(key, entryData), entryData);
+}
+
+bool CVisitedStateCache::getVisitedState(const CGameState & state, CScore & lower, CScore & upper, Card & bestTurn) const
+{
+    unsigned int iPartition = getStatePartitionIdx(state.getStateData());
+    if(iPartition >= PARTITIONS_COUNT || !m_aPartitions[iPartition].m_bEnabled)
+        return false;
+
+    const CachePartition & partition = m_aPartitions[iPartition];
+
+    GameStateKey key;
+    StateMapping mapping;
+    makeStateKey(state, key, mapping);
+
+    // Search the in-memory layer first, and then the attached file
+    uint32_t entryData;
+    bool bFound = findEntry(partition.m_pBuckets[getBucketIdx(key, partition.m_iBucketsCount)], key, entryData);
+    if(!bFound && partition.m_iFileBucketsCount != 0)
+        bFound = findEntry(partition.m_pFileBuckets[getBucketIdx(key, partition.m_iFileBucketsCount)], key, entryData);
+
+    CachePartitionStats & stats = m_aStats[iPartition];
+    if(!bFound)
+    {
+        stats.m_iMisses++;
+        return false;
+    }
+
+    stats.m_iHits++;
+
+    lower = CScore(entryData & 0x0f, (entryData >> 4) & 0x0f, (entryData >> 8) & 0x0f);
+    lower += state.getStateData().m_score;
+    upper = lower;
+
+    unsigned int iTarget = state.getTargetPlayer();
+    if(iTarget < MAX_PLAYERS)
+    {
+        unsigned int iUpper = (entryData >> ENTRY_UPPER_SHIFT) & 0x0f;
+        upper.setPlayerScore(iTarget, static_cast<unsigned char>(state.getStateData().m_score.getPlayerScore(iTarget) + iUpper));
+    }
+
+    bestTurn = getStateCard(mapping, getCardByIdx((entryData >> ENTRY_TURN_SHIFT) & 0x1f));
+    return true;
+}
+
+void CVisitedStateCache::saveToFile(const char * fileName) const
+{
+    CacheFileHeader header;
+    initHeader(header);
+
+    // The file is written under a temporary name, and then replaces the old one, so that
+    // processes, that have the old file mapped (including this one), are not affected
+    std::string tempFileName = std::string(fileName) + ".tmp";
+    std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+    if(!file)
+        throw "CVisitedStateCache::saveToFile(): Cannot create the file";
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for(const CachePartition & partition : m_aPartitions)
+    {
+        // Entries of the attached file fill empty entries of the in-memory layer
+        std::vector<CacheBucket> buckets(partition.m_pBuckets, partition.m_pBuckets + partition.m_iBucketsCount);
+        for(size_t i = 0; i < partition.m_iFileBucketsCount; i++)
+        {
+            const CacheBucket & fileBucket = partition.m_pFileBuckets[i];
+            for(unsigned int j = 0; j < BUCKET_ENTRIES; j++)
+            {
+                uint32_t data = fileBucket.getData(j);
+                if(!isEntryUsed(data))
+                    continue;
+
+                GameStateKey key = lockKey(fileBucket.getLockedKey(j), data);
+                CacheBucket & bucket = buckets[getBucketIdx(key, buckets.size())];
+                if(findEntry(bucket, key, data))
+                    continue;
+
+                for(unsigned int k = 0; k < BUCKET_ENTRIES; k++)
+                {
+                    if(!isEntryUsed(bucket.getData(k)))
+                    {
+                        bucket.setEntry(k, fileBucket.getLockedKey(j), data);
+                        break;
+                    }
+                }
+            }
+        }
+
+        file.write(reinterpret_cast<const char *>(buckets.data()), buckets.size() * sizeof(CacheBucket));
+    }
+
+    file.close();
+    if(!file)
+    {
+        std::remove(tempFileName.c_str());
+        throw "CVisitedStateCache::saveToFile(): Cannot write the file";
+    }
+
+#if defined(_WIN32)
+    // Windows does not replace existing files on rename
+    std::remove(fileName);
+#endif
+
+    if(std::rename(tempFileName.c_str(), fileName) != 0)
+        throw "CVisitedStateCache::saveToFile(): Cannot replace the file";
+}
+
+void CVisitedStateCache::attachFile(const char * fileName)
+{
+    detachFile();
+
+#if defined(_WIN32)
+    // No memory mapping, the file is just read
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if(!file)
+        throw "CVisitedStateCache::attachFile(): Cannot open the file";
+
+    size_t iFileSize = static_cast<size_t>(file.tellg());
+    m_fileBuffer.resize((iFileSize + sizeof(CacheBucket) - 1) / sizeof(CacheBucket));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(m_fileBuffer.data()), iFileSize);
+    if(!file)
+        throw "CVisitedStateCache::attachFile(): Cannot read the file";
+
+    const void * pData = m_fileBuffer.data();
+#else
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        throw "CVisitedStateCache::attachFile(): Cannot open the file";
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        throw "CVisitedStateCache::attachFile(): Cannot get the file size";
+    }
+
+    size_t iFileSize = static_cast<size_t>(fileStat.st_size);
+    void * pData = iFileSize ? mmap(nullptr, iFileSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(pData == MAP_FAILED)
+        throw "CVisitedStateCache::attachFile(): Cannot map the file";
+
+    m_pFileData = pData;
+    m_iFileSize = iFileSize;
+#endif
+
+    const CacheFileHeader * pHeader = static_cast<const CacheFileHeader *>(pData);
+    if(!isValidHeader(pHeader, iFileSize))
+    {
+        detachFile();
+        throw "CVisitedStateCache::attachFile(): Invalid cache file";
+    }
+
+    const CacheBucket * pBuckets = reinterpret_cast<const CacheBucket *>(pHeader + 1);
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+    {
+        m_aPartitions[i].m_pFileBuckets = pBuckets;
+        m_aPartitions[i].m_iFileBucketsCount = static_cast<size_t>(pHeader->m_aBucketsCounts[i]);
+        pBuckets += m_aPartitions[i].m_iFileBucketsCount;
+    }
+}
+
+void CVisitedStateCache::initHeader(CacheFileHeader & header) const
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.m_aMagic, CACHE_FILE_MAGIC, sizeof(header.m_aMagic));
+    header.m_iVersion = CACHE_FILE_VERSION;
+    header.m_iPartitionsCount = PARTITIONS_COUNT;
+    header.m_iBucketSize = sizeof(CacheBucket);
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+        header.m_aBucketsCounts[i] = m_aPartitions[i].m_iBucketsCount;
+}
+
+bool CVisitedStateCache::isValidHeader(const CacheFileHeader * pHeader, size_t iSize)
+{
+    if(iSize < sizeof(CacheFileHeader) ||
+       memcmp(pHeader->m_aMagic, CACHE_FILE_MAGIC, sizeof(pHeader->m_aMagic)) != 0 ||
+       pHeader->m_iVersion != CACHE_FILE_VERSION ||
+       pHeader->m_iPartitionsCount != PARTITIONS_COUNT ||
+       pHeader->m_iBucketSize != sizeof(CacheBucket))
+        return false;
+
+    // Partitions shall take the rest of the data
+    size_t iExpectedSize = sizeof(CacheFileHeader);
+    for(unsigned int i = 0; i < PARTITIONS_COUNT; i++)
+    {
+        uint64_t iCount = pHeader->m_aBucketsCounts[i];
+        if((iCount & (iCount - 1)) != 0 || iCount > (iSize - iExpectedSize) / sizeof(CacheBucket))
+            return false;
+
+        iExpectedSize += static_cast<size_t>(iCount) * sizeof(CacheBucket);
+    }
+
+    return iExpectedSize == iSize;
+}
+
+void CVisitedStateCache::detachFile()
+{
+    for(CachePartition & partition : m_aPartitions)
+    {
+        partition.m_pFileBuckets = nullptr;
+        partition.m_iFileBucketsCount = 0;
+    }
+
+#if defined(_WIN32)
+    m_fileBuffer.clear();
+#else
+    if(m_pFileData)
+        munmap(m_pFileData, m_iFileSize);
+
+    m_pFileData = nullptr;
+    m_iFileSize = 0;
+#endif
+}
@@ -6,11 +6,42 @@
  * @brief The Visited states cache declaration
  */
 
-#include <map>
-#include <sstream>
+#include <atomic>
+#include <vector>
 
+#include "Deal.h"
 #include "GameState.h"
-#include "Path.h"
+
+/// Default visited states cache size in megabytes
+const size_t DEFAULT_CACHE_SIZE_MB = 64;
+
+/// Kind of the score stored in the visited states cache
+enum ScoreBound
+{
+    /// The score is the optimal one
+    SB_EXACT,
+    /// The optimal score is not less than the stored one
+    SB_LOWER,
+    /// The optimal score is not greater than the stored one
+    SB_UPPER
+};
+
+/**
+ * @brief Visited states cache partition statistics
+ */
+struct CachePartitionStats
+{
+    /// Number of found states
+    size_t m_iHits;
+    /// Number of states, that were searched but not found
+    size_t m_iMisses;
+    /// Number of stored states
+    size_t m_iStores;
+    /// Number of states currently in the partition
+    size_t m_iSize;
+    /// Maximum number of states in the partition
+    size_t m_iCapacity;
+};
 
 /**
  * @brief Visited States Cache
@@ -19,93 +50,558 @@
  * multiple times. This class is intended to store (cache) visited states and retrieve processing
  * result quickly when needed.
  *
- * Technically it is implemented using a map between state and resulting path.
+ * States of different stages of the game have different reuse rates and recalculation costs,
+ * so the cache is split into partitions by number of tricks left and by position in the trick
+ * (number of cards on the table). Each partition has its own size, may be switched off (e.g.
+ * to cache only trick starts, or to skip the last tricks, that are cheap to search), and
+ * collects its own statistics (see getPartitionStats()).
+ *
+ * Each partition is a fixed size hash table (transposition table), that is allocated at
+ * once, so that memory usage is predictable. The table consists of 64 byte
+ * buckets, each bucket holds BUCKET_ENTRIES packed 128 bit state keys (see GameStateKey)
+ * and 32 bit entries data, so that a probe touches a single cache line. The key hash selects
+ * the bucket.
+ *
+ * An entry holds just the optimal score and the optimal turn of the state, the whole optimal
+ * path is made by walking the table from the root (see CGameState::playGameRecursive()).
+ *
+ * When the bucket is full, a new state replaces entries stored during previous searches
+ * (see newSearch()) first. States of different depth do not compete for the same buckets,
+ * as they belong to different partitions.
+ * Evicted states are just searched once more, so the search result does not depend on the
+ * table size.
+ *
+ * The score of already played tricks does not affect the optimal continuation, so it is not
+ * a part of the key. Entries hold the score of tricks that are taken from the state on,
+ * and the state score is added back when the entry is retrieved. This way all transpositions,
+ * that differ only by winners of the previous tricks, share the same entry.
+ *
+ * Cache contents may be saved to a file (see saveToFile()), and the file may be attached
+ * to a cache later (see attachFile()), so that the process starts with already solved states.
+ * The file is mapped read-only, so it is shared between processes, and new states go to the
+ * in-memory layer on top of it.
+ * Partitions may also be placed in shared memory (see CSharedVisitedStateCache), so that
+ * processes also share states, that are found while searching.
+ *
+ * Many states are the same game with relabeled cards, so states are stored in a canonical
+ * form (see makeCanonicalKey()), and stored turns are canonical cards as well:
+ * - Only relative order of cards left in game matters, e.g. 9 and Jack are touching cards
+ *   once 10 is played. So card ranks of each suit are compressed to relative ranks among
+ *   the cards left.
+ * - Suits that are not trump are interchangeable, so side suits are sorted by their
+ *   signatures (cards of each hand and on the table).
+ * .
  */
 class CVisitedStateCache
 {
 public:
 
+    /// Number of cache partitions
+    static const unsigned int PARTITIONS_COUNT = HAND_SIZE * MAX_PLAYERS;
+
     /**
      * @brief Create an empty cache object
      *
-     * Creates an empty cache object. States counters are also zeroed.
+     * Creates an empty cache object of the given size. By default only trick starts with
+     * 2 or more tricks left are cached: the size is split equally between their partitions,
+     * while other partitions are switched off and take a single bucket (use setPartitionSize()
+     * before switching them on). States counters are also zeroed.
+     *
+     * @param iSizeMB   - table size in megabytes
+     */
+    explicit CVisitedStateCache(size_t iSizeMB = DEFAULT_CACHE_SIZE_MB);
+
+    /**
+     * @brief The cache destructor
+     *
+     * Detaches the attached file if any
+     */
+    virtual ~CVisitedStateCache();
+
+    /**
+     * @brief Save cache contents to the file
+     *
+     * The file holds a versioned header, and buckets of all partitions with the sizes of the
+     * in-memory layer. Entries of the attached file are saved as well, if there is a free room
+     * for them. Data is saved in the native byte order.
+     *
+     * @throw "const char *" if the file cannot be written
+     *
+     * @param fileName  - name of the file
+     */
+    void saveToFile(const char * fileName) const;
+
+    /**
+     * @brief Attach the cache file
+     *
+     * The file is memory mapped read-only, so that it is loaded in no time, and shared
+     * between processes. States are searched in the in-memory layer first, and then in the
+     * file. New states are stored in the in-memory layer only. Previously attached file
+     * is detached.
+     *
+     * @throw "const char *" if the file cannot be opened, or it is not a valid cache file
+     *        of this version
+     *
+     * @param fileName  - name of the file (see saveToFile())
+     */
+    void attachFile(const char * fileName);
+
+    /**
+     * @brief Detach the cache file
+     *
+     * States of the file are not used any more, the in-memory layer is not changed
+     */
+    void detachFile();
+
+    /**
+     * @brief Retrieve the partition index
+     *
+     * @throw "const char *" if parameters are out of bounds
+     *
+     * @param iTricksLeft   - number of tricks left including the current one (1 to HAND_SIZE)
+     * @param iPosition     - number of cards on the table (0 to MAX_PLAYERS - 1)
+     *
+     * @return zero based partition index
+     */
+    static unsigned int getPartitionIdx(unsigned int iTricksLeft, unsigned int iPosition);
+
+    /**
+     * @brief Set the partition size
+     *
+     * The partition is reallocated, so all its states are lost. Number of buckets is a power
+     * of two, so that the partition may take less memory than specified, but not less than
+     * a single bucket.
+     *
+     * @param iPartition    - partition index (see getPartitionIdx())
+     * @param iSizeKB       - partition size in kilobytes
+     */
+    virtual void setPartitionSize(unsigned int iPartition, size_t iSizeKB);
+
+    /**
+     * @brief Switch the partition on or off
+     *
+     * States of the partition that is switched off are neither stored, nor searched.
+     *
+     * @param iPartition    - partition index (see getPartitionIdx())
+     * @param bEnabled      - \a true to switch the partition on
      */
-    CVisitedStateCache()
+    inline void setPartitionEnabled(unsigned int iPartition, bool bEnabled)
     {
-        m_iCacheHits = 0;
+        m_aPartitions[iPartition].m_bEnabled = bEnabled;
     }
 
     /**
-     * @brief Add a new state to the cache
+     * @brief Retrieve the partition statistics
      *
-     * This method stores a given state and associate a given result with this state
-     * so that it can be retrieved later.
+     * @param iPartition    - partition index (see getPartitionIdx())
+     *
+     * @return the partition statistics
+     */
+    inline const CachePartitionStats & getPartitionStats(unsigned int iPartition) const
+    {
+        return m_aStats[iPartition];
+    }
+
+    /**
+     * @brief Start a new search
      *
-     * @param state - state to store
-     * @param path  - an optimal path associated with this state
+     * Entries of previous searches are still valid, but they are replaced first when the
+     * table is full. This method shall be called before solving a new deal with the same table.
      */
-    void addVisitedState(const CGameState & state, const CPath & path)
+    inline void newSearch()
     {
-        m_cache.emplace(state, path);
+        m_iGeneration++;
     }
 
+    /**
+     * @brief Add a new state to the cache
+     *
+     * This method stores a given state and associate a given result with this state
+     * so that it can be retrieved later. An older entry may be evicted to store the state.
+     *
+     * Scores found with alpha-beta search may be just bounds of the optimal score. Bounds
+     * refer to the score of the player, that all players' strategies refer to (see
+     * CGameState::getTargetPlayer()). The entry keeps both the lower and the upper bound of
+     * the state, a new bound narrows the ones, that are already known.
+     *
+     * @param state     - state to store
+     * @param score     - the optimal score at the end of the game, or its bound
+     * @param bestTurn  - the optimal turn of the state
+     * @param bound     - kind of the score
+     */
+    void addVisitedState(const CGameState & state, const CScore & score, Card bestTurn, ScoreBound bound = SB_EXACT);
+
     /**
      * @brief Retrieve a state from the cache
      *
-     * This method searches the given state in the cache and returns the path associated
-     * with this state, so that no need to process the state once more. If no state found
-     * in the card, an invalid path is returned.
+     * This method searches the given state in the cache and returns bounds of the optimal score
+     * and the turn associated with this state, so that no need to process the state once more.
+     * Bounds are equal if the optimal score is known. Otherwise only the target player's
+     * scores of the bounds are meaningful (see CGameState::getTargetPlayer()).
      *
      * This method also increment hit counter if the state is found. No need to track cache
      * misses as any cache miss will eventually get back as a new state.
      *
-     * @param state - state to search
+     * @param state     - state to search
+     * @param lower     - the lower bound of the optimal score at the end of the game
+     * @param upper     - the upper bound of the optimal score at the end of the game
+     * @param bestTurn  - the optimal turn of the state
      *
-     * @return an optimal path associated with this state, or invalid path object if no state found
+     * @return \a true if the state is found, \a false otherwise
      */
-    CPath getVisitedState(const CGameState & state) const
+    bool getVisitedState(const CGameState & state, CScore & lower, CScore & upper, Card & bestTurn) const;
+
+    /**
+     * @brief Retrieve the optimal score of a state from the cache
+     *
+     * This is the same as the method above, but only states with the exact score are found
+     *
+     * @param state     - state to search
+     * @param score     - the optimal score at the end of the game
+     * @param bestTurn  - the optimal turn of the state
+     *
+     * @return \a true if the state with the exact score is found, \a false otherwise
+     */
+    inline bool getVisitedState(const CGameState & state, CScore & score, Card & bestTurn) const
     {
-        MapGameToPathCIt it = m_cache.find(state);
-        if(it != m_cache.end())
+        CScore upper;
+        return getVisitedState(state, score, upper, bestTurn) && score == upper;
+    }
+
+    /**
+     * @brief Get hit count stats
+     *
+     * @return Current hit counter value of all partitions
+     */
+    size_t getHitsCount() const;
+
+    /**
+     * @brief Get cache size
+     *
+     * @return Current number of stored states in all partitions
+     */
+    size_t getCacheSize() const;
+
+    /**
+     * @brief Get cache capacity
+     *
+     * @return Maximum number of stored states in all partitions
+     */
+    size_t getCapacity() const;
+
+protected:
+    /**
+     * @brief Create a cache object, optionally without partitions buckets
+     *
+     * Partitions get the same sizes and switches as with the public constructor. If buckets
+     * are not allocated, derived classes shall place buckets of all partitions elsewhere
+     * (see setPartitionBuckets()) before the cache is used.
+     *
+     * @param iSizeMB   - table size in megabytes
+     * @param bAllocate - \a true to allocate buckets of partitions
+     */
+    CVisitedStateCache(size_t iSizeMB, bool bAllocate);
+
+    /// Mapping between the state and its canonical form
+    struct StateMapping
+    {
+        /// Cards left in the state (see GameStateData::m_cardsLeft)
+        CardMask m_cardsLeft;
+        /// Canonical suit for each state suit index
+        CardSuit m_aToCanonical[SUITS_COUNT];
+        /// State suit for each canonical suit index
+        CardSuit m_aFromCanonical[SUITS_COUNT];
+    };
+
+    /// Number of entries in a bucket
+    static const unsigned int BUCKET_ENTRIES = 3;
+
+    /// Position of players' strategies in the key (3 bits per player, above the state fields
+    /// of the second word, see GameStateData::pack())
+    static const unsigned int KEY_STRATEGIES_SHIFT = 52;
+
+    ///@name Entry data fields
+    ///
+    /// The lowest 12 bits of the entry data hold the score of the tricks, that are taken
+    /// from the state on (4 bits per player). In zero sum games the target player's score
+    /// is the lower bound of his score.
+    //@{
+    /// Canonical optimal turn index (see getCardIdx())
+    static const unsigned int ENTRY_TURN_SHIFT = 12;
+    /// Entry is used flag, the depth of the state is the one of the partition
+    static const unsigned int ENTRY_USED_SHIFT = 17;
+    /// Search generation, the entry was stored at (see newSearch())
+    static const unsigned int ENTRY_GENERATION_SHIFT = 18;
+    /// Upper bound of the target player's score of the remaining tricks (zero sum games only)
+    static const unsigned int ENTRY_UPPER_SHIFT = 26;
+    //@}
+
+    /**
+     * @brief Cache bucket, that fits a single CPU cache line
+     *
+     * Buckets of a shared cache (see CSharedVisitedStateCache) are read and written by
+     * several processes without locks, so fields are relaxed atomics. An entry, that is
+     * written concurrently, may get the key and the data of different states, such entry
+     * is not found (see lockKey()).
+     */
+    struct alignas(64) CacheBucket
+    {
+        /// Empty bucket
+        CacheBucket() = default;
+
+        /// Copy the bucket entry by entry
+        CacheBucket(const CacheBucket & bucket)
         {
-            m_iCacheHits++;
-            return it->second;
+            *this = bucket;
         }
 
-        return CPath();
-    }
+        /// Copy the bucket entry by entry
+        CacheBucket & operator=(const CacheBucket & bucket)
+        {
+            for(unsigned int i = 0; i < BUCKET_ENTRIES; i++)
+                setEntry(i, bucket.getLockedKey(i), bucket.getData(i));
+
+            return *this;
+        }
+
+        /// Retrieve the locked key of the entry
+        inline GameStateKey getLockedKey(unsigned int i) const
+        {
+            return GameStateKey{{m_aKeys[i][0].load(std::memory_order_relaxed),
+                                 m_aKeys[i][1].load(std::memory_order_relaxed)}};
+        }
+
+        /// Retrieve data of the entry
+        inline uint32_t getData(unsigned int i) const
+        {
+            return m_aData[i].load(std::memory_order_relaxed);
+        }
+
+        /// Store the entry
+        inline void setEntry(unsigned int i, const GameStateKey & lockedKey, uint32_t data)
+        {
+            m_aKeys[i][0].store(lockedKey.m_aWords[0], std::memory_order_relaxed);
+            m_aKeys[i][1].store(lockedKey.m_aWords[1], std::memory_order_relaxed);
+            m_aData[i].store(data, std::memory_order_relaxed);
+        }
+
+        /// Packed canonical states, locked with entries data (see lockKey())
+        std::atomic<uint64_t> m_aKeys[BUCKET_ENTRIES][2];
+        /// Entries data (score, turn, used flag, generation and upper bound fields)
+        std::atomic<uint32_t> m_aData[BUCKET_ENTRIES];
+    };
+
+    static_assert(sizeof(CacheBucket) == 64, "Cache bucket shall take a single cache line");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared cache buckets shall be lock free");
+
+    /// Cache partition
+    struct CachePartition
+    {
+        /// Partition buckets, owned by the partition (see setPartitionBuckets())
+        std::vector<CacheBucket> m_storage;
+        /// Partition buckets (in-memory layer)
+        CacheBucket * m_pBuckets;
+        /// Number of partition buckets
+        size_t m_iBucketsCount;
+        /// Partition buckets of the attached file, or nullptr if no file is attached
+        const CacheBucket * m_pFileBuckets;
+        /// Number of partition buckets of the attached file
+        size_t m_iFileBucketsCount;
+        /// Partition is switched on
+        bool m_bEnabled;
+    };
+
+    /// Cache file header, that is followed by buckets of each partition
+    struct alignas(64) CacheFileHeader
+    {
+        /// File signature (see CACHE_FILE_MAGIC)
+        char m_aMagic[4];
+        /// File format version (see CACHE_FILE_VERSION)
+        uint32_t m_iVersion;
+        /// Number of partitions
+        uint32_t m_iPartitionsCount;
+        /// Size of the bucket
+        uint32_t m_iBucketSize;
+        /// Number of buckets of each partition
+        uint64_t m_aBucketsCounts[PARTITIONS_COUNT];
+    };
+
+    /// Cache file signature
+    static constexpr const char * CACHE_FILE_MAGIC = "PSVC";
+    /// Cache file format version, shall be changed whenever keys or entries format is changed
+    static const uint32_t CACHE_FILE_VERSION = 5;
 
     /**
-     * @brief Get hit count stats
+     * @brief Lock the entry key with the entry data
+     *
+     * Bucket entries are stored with keys xor-ed with a hash of the entry data, so that
+     * an entry, that is written concurrently (see CSharedVisitedStateCache), and has the key
+     * and the data of different states, is not found. Locking the locked key gives the original key.
+     *
+     * @param key   - the key
+     * @param data  - entry data
      *
-     * @return Current hit counter value
+     * @return the locked key
      */
-    size_t getHitsCount() const
+    static inline GameStateKey lockKey(const GameStateKey & key, uint32_t data)
     {
-        return m_iCacheHits;
+        uint64_t lock = data * 0x9e3779b97f4a7c15ull;
+        return GameStateKey{{key.m_aWords[0] ^ lock, key.m_aWords[1] ^ lock}};
+    }
+
+    /// Check if the entry holds a state
+    static inline bool isEntryUsed(uint32_t data)
+    {
+        return (data >> ENTRY_USED_SHIFT) & 0x01;
     }
 
     /**
-     * @brief Get cache size
+     * @brief Make the canonical key of the state
+     *
+     * Cards left of each suit are replaced with the lowest cards of the suit keeping their order.
+     * Then side suits are sorted by their signatures in descending order and take places of
+     * the side suits in ascending order, while the trump suit stays at its place. Suits with
+     * equal signatures are equal in the state, so their order does not matter.
      *
-     * @return Current cache size
+     * @param state     - the state
+     * @param key       - packed canonical state
+     * @param mapping   - mapping between the state and the canonical one
      */
-    size_t getCacheSize() const
+    static void makeCanonicalKey(const GameStateData & state, GameStateKey & key, StateMapping & mapping);
+
+    /**
+     * @brief Make the key of the game state
+     *
+     * The optimal score depends on players' strategies, so the same cards of games with
+     * different strategies are different states. The key is the canonical key of the state
+     * (see makeCanonicalKey()) with strategies packed to the unused bits (see KEY_STRATEGIES_SHIFT).
+     *
+     * @param state     - the game state
+     * @param key       - the key
+     * @param mapping   - mapping between the state and the canonical one
+     */
+    static void makeStateKey(const CGameState & state, GameStateKey & key, StateMapping & mapping);
+
+    /**
+     * @brief Convert the state card to the canonical card
+     *
+     * @param mapping   - the state mapping (see makeCanonicalKey())
+     * @param card      - card left in the state
+     *
+     * @return the canonical card
+     */
+    static Card getCanonicalCard(const StateMapping & mapping, Card card);
+
+    /**
+     * @brief Convert the canonical card back to the state card
+     *
+     * @param mapping   - the state mapping (see makeCanonicalKey())
+     * @param card      - the canonical card
+     *
+     * @return card left in the state
+     */
+    static Card getStateCard(const StateMapping & mapping, Card card);
+
+    /**
+     * @brief Retrieve the partition of the state
+     *
+     * @param state - the state
+     *
+     * @return partition index, or PARTITIONS_COUNT for the final state (it is never cached)
+     */
+    static inline unsigned int getStatePartitionIdx(const GameStateData & state)
     {
-        return m_cache.size();
+        unsigned int iCards = countCards(state.m_aHands[0] | state.m_aHands[1] | state.m_aHands[2]);
+        unsigned int iTricksLeft = (iCards + state.m_iCardsOnTableCount) / MAX_PLAYERS;
+        if(iTricksLeft == 0)
+            return PARTITIONS_COUNT;
+
+        return (iTricksLeft - 1) * MAX_PLAYERS + state.m_iCardsOnTableCount;
     }
 
-protected:
-    /// Handy typedef for the cache storage type
-    typedef std::map<CGameState, CPath> MapGameToPath;
-    /// Handy typedef for the cache iterator type
-    typedef MapGameToPath::const_iterator MapGameToPathCIt;
+    /**
+     * @brief Retrieve the bucket for the key
+     *
+     * @param key           - packed canonical state
+     * @param iBucketsCount - number of buckets (power of two)
+     *
+     * @return bucket index
+     */
+    static size_t getBucketIdx(const GameStateKey & key, size_t iBucketsCount);
+
+    /**
+     * @brief Find the entry in the bucket
+     *
+     * @param bucket    - the bucket
+     * @param key       - packed canonical state
+     * @param data      - the entry data
+     *
+     * @return \a true if the entry with the key is found
+     */
+    static bool findEntry(const CacheBucket & bucket, const GameStateKey & key, uint32_t & data);
+
+    /**
+     * @brief Retrieve number of buckets of the partition of the given size
+     *
+     * @param iSizeKB   - partition size in kilobytes
+     *
+     * @return the largest power of two number of buckets, that fits the size, but not less than 1
+     */
+    static size_t getBucketsCount(size_t iSizeKB);
+
+    /**
+     * @brief Use external buckets for the partition
+     *
+     * The partition stops using its own buckets, so that derived classes may place buckets
+     * elsewhere, e.g. in shared memory. External buckets shall outlive the cache.
+     *
+     * @param iPartition    - partition index
+     * @param pBuckets      - buckets
+     * @param iBucketsCount - number of buckets (power of two)
+     */
+    void setPartitionBuckets(unsigned int iPartition, CacheBucket * pBuckets, size_t iBucketsCount);
+
+    /**
+     * @brief Fill the cache file header for the current partitions
+     *
+     * @param header    - the header
+     */
+    void initHeader(CacheFileHeader & header) const;
+
+    /**
+     * @brief Validate the cache file header
+     *
+     * @param pHeader   - the header followed by the partitions data
+     * @param iSize     - size of the data including the header
+     *
+     * @return \a true if the header is valid, and matches the data size
+     */
+    static bool isValidHeader(const CacheFileHeader * pHeader, size_t iSize);
+
+    /// Cache partitions
+    CachePartition m_aPartitions[PARTITIONS_COUNT];
+    /// Current search generation, the field of entries is of the same size
+    uint8_t m_iGeneration;
+
+#if defined(_WIN32)
+    /// Attached file contents
+    std::vector<CacheBucket> m_fileBuffer;
+#else
+    /// Mapped file, or nullptr if no file is attached
+    void * m_pFileData;
+    /// Mapped file size
+    size_t m_iFileSize;
+#endif
 
-    /// The storage of visited states and their solve paths
-    MapGameToPath m_cache;
+    /// Partitions statistics
+    mutable CachePartitionStats m_aStats[PARTITIONS_COUNT];
 
-    /// Number of cache hits
-    mutable size_t m_iCacheHits;
+private:
+    /// The blocked copy constructor, the cache owns the attached file
+    CVisitedStateCache(const CVisitedStateCache &) = delete;
+    /// The blocked assignment operator
+    CVisitedStateCache & operator=(const CVisitedStateCache &) = delete;
 };
 
 #endif // VISITEDSTATECACHE_H